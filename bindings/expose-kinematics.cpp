@@ -114,7 +114,24 @@ void exposeKinematics()
           .def<void (KinematicsSolver::*)(Task&)>("remove_task", &KinematicsSolver::remove_task)
           .def<void (KinematicsSolver::*)(FrameTask&)>("remove_task", &KinematicsSolver::remove_task)
           .def("remove_constraint", &KinematicsSolver::remove_constraint)
-          .def("solve", &KinematicsSolver::solve);
+          .def("solve", &KinematicsSolver::solve)
+          .def(
+              "solve_batch",
+              +[](boost::python::list py_solvers, bool apply) {
+                std::vector<KinematicsSolver*> solvers;
+                for (int k = 0; k < len(py_solvers); k++)
+                {
+                  solvers.push_back(&extract<KinematicsSolver&>(py_solvers[k])());
+                }
+
+                boost::python::list solutions;
+                for (auto& solution : KinematicsSolver::solve_batch(solvers, apply))
+                {
+                  solutions.append(solution);
+                }
+                return solutions;
+              })
+          .staticmethod("solve_batch");
 
   class__<Task, bases<tools::Prioritized>, boost::noncopyable>("Task", no_init)
       .add_property(
@@ -191,8 +208,10 @@ void exposeKinematics()
           &AxisAlignTask::targetAxis_world);
 
   class__<JointsTask, bases<Task>>("JointsTask", init<>())
-      .def("set_joint", &JointsTask::set_joint)
-      .def("get_joint", &JointsTask::get_joint)
+      .def<void (JointsTask::*)(std::string, double)>("set_joint", &JointsTask::set_joint)
+      .def<void (JointsTask::*)(RobotWrapper::JointIndex, double)>("set_joint", &JointsTask::set_joint)
+      .def<double (JointsTask::*)(std::string)>("get_joint", &JointsTask::get_joint)
+      .def<double (JointsTask::*)(RobotWrapper::JointIndex)>("get_joint", &JointsTask::get_joint)
       .def(
           "set_joints", +[](JointsTask& task, boost::python::dict& py_dict) {
             update_map<std::string, double>(task.joints, py_dict);
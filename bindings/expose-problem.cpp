@@ -69,7 +69,11 @@ void exposeProblem()
             }
           })
       .add_property("weight", &ProblemConstraint::weight)
+      .add_property("level", &ProblemConstraint::level, &ProblemConstraint::level)
       .add_property("is_active", &ProblemConstraint::is_active)
+      .add_property("active_rows", &ProblemConstraint::active_rows)
+      .add_property(
+          "duals", +[](const ProblemConstraint& constraint) { return constraint.duals; })
       .def<void (ProblemConstraint::*)(std::string, double)>("configure", &ProblemConstraint::configure,
                                                              configure_overloads());
 
@@ -101,6 +105,32 @@ void exposeProblem()
       .def("value", &Integrator::Trajectory::value)
       .def("duration", &Integrator::Trajectory::duration);
 
+  enum_<Problem::QPSolver>("QPSolver")
+      .value("eiquadprog", Problem::QPSolver::Eiquadprog)
+      .value("admm", Problem::QPSolver::ADMM)
+      .value("riccati", Problem::QPSolver::Riccati);
+
+  class__<ADMMSolver>("ADMMSolver")
+      .add_property("rho", &ADMMSolver::rho, &ADMMSolver::rho)
+      .add_property("sigma", &ADMMSolver::sigma, &ADMMSolver::sigma)
+      .add_property("alpha", &ADMMSolver::alpha, &ADMMSolver::alpha)
+      .add_property("eps_abs", &ADMMSolver::eps_abs, &ADMMSolver::eps_abs)
+      .add_property("eps_rel", &ADMMSolver::eps_rel, &ADMMSolver::eps_rel)
+      .add_property("max_iterations", &ADMMSolver::max_iterations, &ADMMSolver::max_iterations)
+      .add_property("adaptive_rho_interval", &ADMMSolver::adaptive_rho_interval, &ADMMSolver::adaptive_rho_interval)
+      .add_property("iterations", &ADMMSolver::iterations)
+      .add_property("primal_residual", &ADMMSolver::primal_residual)
+      .add_property("dual_residual", &ADMMSolver::dual_residual);
+
+  class__<RiccatiSolver>("RiccatiSolver")
+      .add_property("max_iterations", &RiccatiSolver::max_iterations, &RiccatiSolver::max_iterations)
+      .add_property("tolerance", &RiccatiSolver::tolerance, &RiccatiSolver::tolerance)
+      .add_property("iterations", &RiccatiSolver::iterations)
+      .add_property(
+          "equalities_multipliers", +[](const RiccatiSolver& solver) { return solver.equalities_multipliers; })
+      .add_property(
+          "inequalities_multipliers", +[](const RiccatiSolver& solver) { return solver.inequalities_multipliers; });
+
   class__<Problem>("Problem")
       .def("add_variable", &Problem::add_variable, return_internal_reference<>())
       .def("add_constraint", &Problem::add_constraint, return_internal_reference<>())
@@ -108,6 +138,8 @@ void exposeProblem()
       .def("solve", &Problem::solve)
       .def("clear_variables", &Problem::clear_variables)
       .def("clear_constraints", &Problem::clear_constraints)
+      .def("constraints_count", &Problem::constraints_count)
+      .def("constraints_duals", &Problem::constraints_duals)
       .def("dump_status", &Problem::dump_status)
       .add_property("x", &Problem::x)
       .add_property("n_variables", &Problem::n_variables, &Problem::n_variables)
@@ -119,6 +151,29 @@ void exposeProblem()
       .add_property("use_sparsity", &Problem::use_sparsity, &Problem::use_sparsity)
       .add_property("rewrite_equalities", &Problem::rewrite_equalities, &Problem::rewrite_equalities)
       .add_property("regularization", &Problem::regularization, &Problem::regularization)
+      .add_property("reuse_structure", &Problem::reuse_structure, &Problem::reuse_structure)
+      .add_property("structure_reused", &Problem::structure_reused)
+      .add_property("qr_reused", &Problem::qr_reused)
+      .add_property("hierarchical", &Problem::hierarchical, &Problem::hierarchical)
+      .add_property(
+          "levels_solve_times", +[](const Problem& problem) { return problem.levels_solve_times; })
+      .add_property("warm_start", &Problem::warm_start, &Problem::warm_start)
+      .add_property("warm_start_max_iterations", &Problem::warm_start_max_iterations,
+                    &Problem::warm_start_max_iterations)
+      .add_property("warm_started", &Problem::warm_started)
+      .add_property("warm_start_iterations", &Problem::warm_start_iterations)
+      .add_property("direct_solve", &Problem::direct_solve, &Problem::direct_solve)
+      .add_property("direct_solved", &Problem::direct_solved)
+      .add_property("factorization_reused", &Problem::factorization_reused)
+      .add_property("incremental_objective", &Problem::incremental_objective, &Problem::incremental_objective)
+      .add_property("max_rank_updates", &Problem::max_rank_updates, &Problem::max_rank_updates)
+      .add_property("active_set_size", &Problem::active_set_size)
+      .add_property("solve_time", &Problem::solve_time)
+      .add_property("expression_allocations", &Problem::expression_allocations)
+      .add_property("qp_solver", &Problem::qp_solver, &Problem::qp_solver)
+      .add_property("admm", &Problem::admm)
+      .add_property("riccati", &Problem::riccati)
+      .add_property("riccati_fallback", &Problem::riccati_fallback)
       .add_property(
           "slacks", +[](const Problem& problem) { return problem.slacks; });
 
@@ -130,9 +185,9 @@ void exposeProblem()
 
   class__<Expression>("Expression")
       .add_property(
-          "A", +[](Expression& e) { return e.A; })
+          "A", +[](Expression& e) { return Eigen::MatrixXd(e.A); })
       .add_property(
-          "b", +[](Expression& e) { return e.b; })
+          "b", +[](Expression& e) { return Eigen::VectorXd(e.b); })
       .def("__len__", &Expression::rows)
       .def("is_scalar", &Expression::is_scalar)
       .def("is_constant", &Expression::is_constant)
@@ -19,6 +19,8 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(read_from_histories_overloads, read_from_
 #endif
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(joint_names_overloads, joint_names, 0, 1);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(distances_overloads, distances, 0, 1);
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(prune_collision_pairs_overloads, prune_collision_pairs, 0, 1);
 
 template <class RobotType, class W1>
 void exposeRobotType(class_<RobotType, W1>& type)
@@ -27,13 +29,21 @@ void exposeRobotType(class_<RobotType, W1>& type)
       .add_property("model", &RobotType::model)
       .add_property("collision_model", &RobotType::collision_model)
       .add_property("visual_model", &RobotType::visual_model)
+      .add_property("parallel_collisions", &RobotType::parallel_collisions, &RobotType::parallel_collisions)
       .def("load_collision_pairs", &RobotType::load_collision_pairs)
-      .def("get_joint_offset", &RobotType::get_joint_offset)
-      .def("get_joint_v_offset", &RobotType::get_joint_v_offset)
+      .def("save_collision_pairs", &RobotType::save_collision_pairs)
+      .def("prune_collision_pairs", &RobotType::prune_collision_pairs, prune_collision_pairs_overloads())
+      .def<int (RobotType::*)(const std::string&)>("get_joint_offset", &RobotType::get_joint_offset)
+      .def<int (RobotType::*)(RobotWrapper::JointIndex)>("get_joint_offset", &RobotType::get_joint_offset)
+      .def<int (RobotType::*)(const std::string&)>("get_joint_v_offset", &RobotType::get_joint_v_offset)
+      .def<int (RobotType::*)(RobotWrapper::JointIndex)>("get_joint_v_offset", &RobotType::get_joint_v_offset)
+      .def("get_joint_index", &RobotType::get_joint_index)
       .def("reset", &RobotType::reset)
       .def("neutral_state", &RobotType::neutral_state)
-      .def("set_joint", &RobotType::set_joint)
-      .def("get_joint", &RobotType::get_joint)
+      .def<void (RobotType::*)(const std::string&, double)>("set_joint", &RobotType::set_joint)
+      .def<void (RobotType::*)(RobotWrapper::JointIndex, double)>("set_joint", &RobotType::set_joint)
+      .def<double (RobotType::*)(const std::string&)>("get_joint", &RobotType::get_joint)
+      .def<double (RobotType::*)(RobotWrapper::JointIndex)>("get_joint", &RobotType::get_joint)
       .def("set_joint_velocity", &RobotType::set_joint_velocity)
       .def("get_joint_velocity", &RobotType::get_joint_velocity)
       .def("set_joint_acceleration", &RobotType::set_joint_acceleration)
@@ -56,12 +66,13 @@ void exposeRobotType(class_<RobotType, W1>& type)
       .def("joint_names", &RobotType::joint_names, joint_names_overloads())
       .def("frame_names", &RobotType::frame_names)
       .def("self_collisions", &RobotType::self_collisions)
-      .def("distances", &RobotType::distances)
+      .def("distances", &RobotType::distances, distances_overloads())
       .def("com_jacobian", &RobotType::com_jacobian)
       .def("com_jacobian_time_variation", &RobotType::com_jacobian_time_variation)
       .def("generalized_gravity", &RobotType::generalized_gravity)
       .def("non_linear_effects", &RobotType::non_linear_effects)
       .def("mass_matrix", &RobotType::mass_matrix)
+      .def("mass_matrix_cholesky", &RobotType::mass_matrix_cholesky)
       .def("set_gravity", &RobotType::set_gravity)
       .def("total_mass", &RobotType::total_mass)
       .def("integrate", &RobotType::integrate)
@@ -126,6 +137,16 @@ void exposeRobotType(class_<RobotType, W1>& type)
                                 const std::string& reference) { return robot.joint_jacobian(joint, reference); })
       .def(
           "make_solver", +[](RobotType& robot) { return placo::kinematics::KinematicsSolver(robot); })
+      .def(
+          "make_contexts",
+          +[](RobotType& robot, int count) {
+            boost::python::list contexts;
+            for (int k = 0; k < count; k++)
+            {
+              contexts.append(RobotType(robot));
+            }
+            return contexts;
+          })
       .def("add_q_noise", &RobotType::add_q_noise);
 }
 
@@ -133,7 +154,10 @@ void exposeRobotWrapper()
 {
   enum_<RobotWrapper::Flags>("Flags")
       .value("collision_as_visual", RobotWrapper::Flags::COLLISION_AS_VISUAL)
-      .value("ignore_collisions", RobotWrapper::Flags::IGNORE_COLLISIONS);
+      .value("ignore_collisions", RobotWrapper::Flags::IGNORE_COLLISIONS)
+      .value("convex_collisions", RobotWrapper::Flags::CONVEX_COLLISIONS)
+      .value("skip_collisions_check", RobotWrapper::Flags::SKIP_COLLISIONS_CHECK)
+      .value("model_cache", RobotWrapper::Flags::MODEL_CACHE);
 
   class__<RobotWrapper::State>("RobotWrapper_State")
       .add_property(
@@ -171,6 +195,9 @@ void exposeRobotWrapper()
   class_<RobotWrapper> robotWrapper =
       class__<RobotWrapper>("RobotWrapper", init<std::string, optional<int, std::string>>());
   exposeRobotType<RobotWrapper>(robotWrapper);
+  robotWrapper.def("clear_model_cache", &RobotWrapper::clear_model_cache).staticmethod("clear_model_cache");
+  robotWrapper.def(
+      "assign", +[](RobotWrapper& robot, const RobotWrapper& other) { robot = other; });
 
   class_<HumanoidRobot, bases<RobotWrapper>> humanoidWrapper =
       class__<HumanoidRobot, bases<RobotWrapper>>("HumanoidRobot", init<std::string, optional<int, std::string>>());
@@ -57,6 +57,9 @@ void exposeTools()
       .add_property("name", &Prioritized::name)
       .add_property(
           "priority", +[](Prioritized& pri) { return pri.priority_name(); })
+      .add_property("level", &Prioritized::level, &Prioritized::level)
+      .add_property(
+          "duals", +[](Prioritized& pri) { return pri.duals; })
       .def<void (Prioritized::*)(std::string, std::string, double)>("configure", &Prioritized::configure,
                                                                     configure_overloads());
 
@@ -26,6 +26,48 @@ class TestKinematicsSolver(unittest.TestCase):
         self.solver.remove_task(frame_task)
         self.assertEqual(self.solver.tasks_count(), 0, msg="There should be no more task")
 
+    def test_solve_batch(self):
+        robots = [
+            placo.RobotWrapper(f"{this_dir}/quadruped/robot.urdf", placo.Flags.collision_as_visual) for _ in range(4)
+        ]
+        solvers = []
+        for k, robot in enumerate(robots):
+            robot.update_kinematics()
+            solver = robot.make_solver()
+            solver.mask_fbase(True)
+            T_world_leg = robot.get_T_world_frame("leg")
+            T_world_leg[2, 3] += 0.01 * (k + 1)
+            solver.add_position_task("leg", T_world_leg[:3, 3])
+            solver.add_regularization_task(1e-6)
+            solvers.append(solver)
+
+        solutions = placo.KinematicsSolver.solve_batch(solvers, False)
+        self.assertEqual(len(solutions), len(solvers))
+
+        # The results should be the same as solving each solver alone
+        for solver, solution in zip(solvers, solutions):
+            self.assertTrue(np.allclose(solver.solve(False), solution))
+
+    def test_masked_fbase_sparsity(self):
+        """
+        With a masked floating base, the declared tasks sparsity is carried through the equalities projection and
+        gives the same solution as the dense hessian
+        """
+        solutions = []
+        for use_sparsity in [True, False]:
+            robot = placo.RobotWrapper(f"{this_dir}/quadruped/robot.urdf", placo.Flags.collision_as_visual)
+            robot.update_kinematics()
+            solver = robot.make_solver()
+            solver.problem.use_sparsity = use_sparsity
+            solver.mask_fbase(True)
+            T_world_leg = robot.get_T_world_frame("leg")
+            solver.add_position_task("leg", T_world_leg[:3, 3] + np.array([0.01, 0.0, 0.02]))
+            solver.add_orientation_task("tip", np.eye(3))
+            solver.add_regularization_task(1e-6)
+            solutions.append(solver.solve(False))
+
+        self.assertTrue(np.allclose(solutions[0], solutions[1]))
+
 
 if __name__ == "__main__":
     unittest.main()
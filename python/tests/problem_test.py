@@ -167,6 +167,26 @@ class TestProblem(unittest.TestCase):
         # Testing that inequality is still enforced
         self.assertTrue(integrator.value(0.5, 0) <= -5.0)
 
+    def test_integrator_riccati(self):
+        # Same problem as above, solved in stage-wise form
+        problem = placo.Problem()
+        problem.qp_solver = placo.QPSolver.riccati
+        x = problem.add_variable(10)
+        integrator = placo.Integrator(x, np.array([1.0, 2.0, 3.0]), 3, 0.1)
+
+        problem.add_constraint(integrator.expr(10, 0) == 4.0)
+        problem.add_constraint(integrator.expr(10, 1) == 5.0)
+        problem.add_constraint(integrator.expr(10, 2) == 6.0)
+        problem.add_constraint(integrator.expr(5, 0) <= -5.0)
+
+        problem.solve()
+        self.assertFalse(problem.riccati_fallback)
+
+        self.assertNumpyEqual(integrator.value(1.0, 0), 4)
+        self.assertNumpyEqual(integrator.value(1.0, 1), 5)
+        self.assertNumpyEqual(integrator.value(1.0, 2), 6)
+        self.assertTrue(integrator.value(0.5, 0) <= -5.0 + 1e-6)
+
     def test_integrator_expr_x0(self):
         # Creating a problem
         problem = placo.Problem()
@@ -349,11 +369,155 @@ class TestProblem(unittest.TestCase):
         cst1 = problem.add_constraint(x.expr() >= 2.0)
         cst2 = problem.add_constraint(x.expr() >= 3.0)
         cst3 = problem.add_constraint(y.expr() >= -1.5)
+
+        # Only the second row of this constraint is active
+        z = problem.add_variable(2)
+        cst4 = problem.add_constraint(z.expr() >= np.array([-1.0, 1.0]))
         problem.solve()
 
         self.assertFalse(cst1.is_active)
         self.assertTrue(cst2.is_active)
         self.assertFalse(cst3.is_active)
+        self.assertEqual(list(cst2.active_rows), [0])
+        self.assertEqual(list(cst4.active_rows), [1])
+
+    def test_duals(self):
+        """
+        Checking the Lagrange multipliers, the objective gradient should be balanced by the hard constraints
+        """
+        problem = placo.Problem()
+        x = problem.add_variable(2)
+
+        soft = problem.add_constraint(x.expr() == np.array([3.0, 3.0]))
+        soft.configure("soft", 1.0)
+        inequality = problem.add_constraint(x.expr(0, 1) <= 1.0)
+        equality = problem.add_constraint(x.expr(1, 1) == 2.0)
+        problem.solve()
+
+        self.assertNumpyEqual(soft.duals, np.array([2.0, 1.0]))
+        self.assertNumpyEqual(inequality.duals, np.array([2.0]))
+        self.assertNumpyEqual(equality.duals, np.array([-1.0]))
+
+    def test_hierarchical(self):
+        """
+        With a hierarchical solve, the second level should be optimized without degrading the first one
+        """
+        problem = placo.Problem()
+        problem.hierarchical = True
+        x = problem.add_variable(2)
+
+        first = problem.add_constraint(x.expr(0, 1) + x.expr(1, 1) == 2.0)
+        first.configure("soft", 1.0)
+        second = problem.add_constraint(x.expr() == np.array([3.0, 0.0]))
+        second.configure("soft", 1.0)
+        second.level = 1
+        problem.solve()
+
+        self.assertNumpyEqual(x.value, np.array([2.5, -0.5]), epsilon=1e-4)
+        self.assertEqual(len(problem.levels_solve_times), 2)
+
+    def test_warm_start(self):
+        """
+        Solving twice the same problem with warm start should re-use the previous active set
+        """
+        problem = placo.Problem()
+        problem.warm_start = True
+        x = problem.add_variable(2)
+
+        problem.add_constraint(x.expr() == np.array([3.0, 3.0])).configure("soft", 1.0)
+        problem.add_constraint(x.expr(0, 1) <= 1.0)
+        problem.add_constraint(x.expr(1, 1) <= 5.0)
+
+        problem.solve()
+        self.assertNumpyEqual(x.value, np.array([1.0, 3.0]))
+
+        problem.solve()
+        self.assertTrue(problem.warm_started)
+        self.assertNumpyEqual(x.value, np.array([1.0, 3.0]))
+
+    def test_qr_reuse(self):
+        """
+        When only the right-hand side of the equality constraints changes, the QR decomposition should be re-used
+        """
+        problem = placo.Problem()
+        x = problem.add_variable(3)
+
+        for target in [1.0, 2.0]:
+            problem.clear_constraints()
+            problem.add_constraint(x.expr() == np.array([3.0, 3.0, 3.0])).configure("soft", 1.0)
+            problem.add_constraint(x.expr(0, 1) <= 1.0)
+            problem.add_constraint(x.expr(1, 1) + x.expr(2, 1) == target)
+            problem.solve()
+
+            self.assertEqual(problem.qr_reused, target == 2.0)
+            self.assertNumpyEqual(x.value, np.array([1.0, target / 2, target / 2]))
+
+    def test_direct_solve(self):
+        """
+        Problems without inequalities are solved directly, re-using the factorization when only the targets change
+        """
+        problem = placo.Problem()
+        problem.rewrite_equalities = False
+        x = problem.add_variable(3)
+
+        for target in [1.0, 2.0]:
+            problem.clear_constraints()
+            problem.add_constraint(x.expr() == np.array([3.0, 3.0, 3.0])).configure("soft", 1.0)
+            problem.add_constraint(x.expr(1, 1) + x.expr(2, 1) == target)
+            problem.solve()
+
+            self.assertTrue(problem.direct_solved)
+            self.assertEqual(problem.factorization_reused, target == 2.0)
+            self.assertNumpyEqual(x.value, np.array([3.0, target / 2, target / 2]), epsilon=1e-4)
+
+    def test_incremental_objective(self):
+        """
+        With incremental objective, changing the target or the weight of a soft constraint updates the factorization
+        """
+        problem = placo.Problem()
+        problem.reuse_structure = True
+        problem.incremental_objective = True
+        x = problem.add_variable(8)
+
+        for target, weight in [(1.0, 1.0), (2.0, 1.0), (2.0, 4.0), (2.0, 0.5)]:
+            problem.clear_constraints()
+            problem.add_constraint(x.expr() == 3.0 * np.ones(8)).configure("soft", 1.0)
+            problem.add_constraint(x.expr(0, 1) == target).configure("soft", weight)
+            problem.solve()
+
+            self.assertTrue(problem.direct_solved)
+            self.assertEqual(problem.factorization_reused, (target, weight) == (2.0, 1.0))
+            self.assertNumpyEqual(x.value[0], (3.0 + weight * target) / (1.0 + weight), epsilon=1e-4)
+            self.assertNumpyEqual(x.value[1:], 3.0 * np.ones(7), epsilon=1e-4)
+
+    def test_admm(self):
+        """
+        The sparse ADMM solver should find the same solution as the dense one (up to its tolerance)
+        """
+        problem = placo.Problem()
+        problem.qp_solver = placo.QPSolver.admm
+        x = problem.add_variable(3)
+
+        problem.add_constraint(x.expr() == np.array([3.0, 3.0, 3.0])).configure("soft", 1.0)
+        problem.add_constraint(x.expr(0, 1) <= 1.0)
+        problem.add_constraint(x.expr(2, 1) == 2.0)
+
+        problem.solve()
+        self.assertNumpyEqual(x.value, np.array([1.0, 3.0, 2.0]), epsilon=1e-4)
+
+    def test_sparsity(self):
+        """
+        Testing a soft constraint whose non-zero columns are not contiguous
+        """
+        problem = placo.Problem()
+        problem.use_sparsity = True
+        x = problem.add_variable(3)
+
+        problem.add_constraint(x.expr(0, 1) + x.expr(2, 1) == 3.0).configure("soft", 1.0)
+        problem.add_constraint(x.expr(0, 1) == 2.0).configure("soft", 1.0)
+
+        problem.solve()
+        self.assertNumpyEqual(x.value, np.array([2.0, 0.0, 1.0]), epsilon=1e-4)
 
     def test_exactly_constrained(self):
         """
@@ -1,6 +1,7 @@
 import unittest
 import placo
 import os
+import tempfile
 import numpy as np
 from placo_utils.tf import tf
 
@@ -75,6 +76,22 @@ class TestWrapper(unittest.TestCase):
             np.linalg.norm(T_world_tip1 - T_world_tip2) > 0.05, msg="Moving leg3a via set_joint should move the leg tip"
         )
 
+    def test_joint_index(self):
+        """
+        Joints can be accessed using their indices
+        """
+        index = self.robot.get_joint_index("leg3_a")
+        self.robot.set_joint(index, 0.5)
+
+        self.assertAlmostEqual(self.robot.get_joint("leg3_a"), 0.5)
+        self.assertAlmostEqual(self.robot.get_joint(index), 0.5)
+        self.assertEqual(self.robot.get_joint_offset(index), self.robot.get_joint_offset("leg3_a"))
+        self.assertEqual(self.robot.get_joint_v_offset(index), self.robot.get_joint_v_offset("leg3_a"))
+
+        # Out of range and non-actuated (universe) joints indices are rejected
+        self.assertRaises(RuntimeError, self.robot.get_joint, 1000)
+        self.assertRaises(RuntimeError, self.robot.set_joint, 0, 0.5)
+
     def test_change_state(self):
         """
         We also move one DoF but by accessing state().q
@@ -109,6 +126,61 @@ class TestWrapper(unittest.TestCase):
             np.linalg.norm(self.robot.get_T_world_frame("body") - T_world_body), 0.0, msg="Body frame should be identity"
         )
 
+    def test_contexts(self):
+        """
+        Contexts share the robot model, but have their own state and data
+        """
+        self.robot.update_kinematics()
+        T_world_tip = self.robot.get_T_world_frame("tip")[:3, 3]
+
+        contexts = self.robot.make_contexts(2)
+        self.assertEqual(len(contexts), 2)
+
+        contexts[0].set_joint("leg3_a", 1.0)
+        contexts[0].update_kinematics()
+
+        self.assertAlmostEqual(self.robot.get_joint("leg3_a"), 0.0, msg="The original state should not change")
+        self.assertAlmostEqual(contexts[1].get_joint("leg3_a"), 0.0, msg="Other contexts state should not change")
+        self.assertAlmostEqual(np.linalg.norm(self.robot.get_T_world_frame("tip")[:3, 3] - T_world_tip), 0.0)
+        self.assertAlmostEqual(np.linalg.norm(contexts[1].get_T_world_frame("tip")[:3, 3] - T_world_tip), 0.0)
+        self.assertTrue(np.linalg.norm(contexts[0].get_T_world_frame("tip")[:3, 3] - T_world_tip) > 0.05)
+
+    def test_assign_parallel_distances(self):
+        """
+        A robot assigned from another one computes its distances with the other one's collision pairs
+        """
+        robot = placo.RobotWrapper(f"{this_dir}/sigmaban/robot.urdf", placo.Flags.collision_as_visual)
+        robot.parallel_collisions = True
+        robot.distances()
+
+        # The parallel collisions option is also assigned
+        robot.assign(self.robot)
+        robot.parallel_collisions = True
+        distances = robot.distances()
+        expected = self.robot.distances()
+
+        self.assertEqual(len(distances), len(expected))
+        for distance, expected_distance in zip(distances, expected):
+            self.assertEqual((distance.objA, distance.objB), (expected_distance.objA, expected_distance.objB))
+            self.assertAlmostEqual(distance.min_distance, expected_distance.min_distance)
+
+    def test_prune_collision_pairs(self):
+        """
+        Pruned collision pairs can be saved and loaded back
+        """
+        def collision_pairs():
+            return sorted(tuple(sorted((pair.first, pair.second))) for pair in self.robot.collision_model.collisionPairs)
+
+        pairs = len(self.robot.collision_model.collisionPairs)
+        removed = self.robot.prune_collision_pairs(50)
+        pruned_pairs = collision_pairs()
+        self.assertEqual(len(pruned_pairs), pairs - removed)
+
+        filename = f"{tempfile.mkdtemp()}/collisions.json"
+        self.robot.save_collision_pairs(filename)
+        self.robot.load_collision_pairs(filename)
+        self.assertEqual(collision_pairs(), pruned_pairs)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -468,6 +468,7 @@ DynamicsSolver::Result DynamicsSolver::solve(bool integrate)
   {
     if (task->A.rows() == 0)
     {
+      task->problem_constraints_start = task->problem_constraints_end = 0;
       continue;
     }
 
@@ -493,13 +494,21 @@ DynamicsSolver::Result DynamicsSolver::solve(bool integrate)
       e.b = -task->b;
     }
 
-    problem.add_constraint(e == 0).configure(task_priority, task->weight);
+    task->problem_constraints_start = problem.constraints_count();
+    ProblemConstraint& task_constraint = problem.add_constraint(e == 0);
+    task_constraint.configure(task_priority, task->weight);
+    task_constraint.level = task->level;
+    task->problem_constraints_end = problem.constraints_count();
   }
 
   // Add constraints
   for (auto constraint : constraints)
   {
+    constraint->problem_constraints_start = problem.constraints_count();
     constraint->add_constraint(problem, tau);
+    constraint->problem_constraints_end = problem.constraints_count();
+    problem.set_constraints_level(constraint->problem_constraints_start, constraint->problem_constraints_end,
+                                  constraint->level);
   }
 
   // Floating base has no torque, except if is masked (in that case, the floating base torque will
@@ -518,6 +527,17 @@ DynamicsSolver::Result DynamicsSolver::solve(bool integrate)
     problem.solve();
     result.success = true;
 
+    // Retrieving the tasks and constraints Lagrange multipliers
+    for (auto& task : tasks)
+    {
+      task->duals = problem.constraints_duals(task->problem_constraints_start, task->problem_constraints_end);
+    }
+    for (auto constraint : constraints)
+    {
+      constraint->duals =
+          problem.constraints_duals(constraint->problem_constraints_start, constraint->problem_constraints_end);
+    }
+
     // Exporting result values
     result.tau = tau.value(problem.x);
     result.qdd = qdd.value(problem.x);
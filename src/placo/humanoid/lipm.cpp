@@ -89,6 +89,102 @@ Expression LIPM::dzmp(int timestep, double omega_2)
          (y.expr(timestep, 1) - (1 / (omega_2)) * y.expr(timestep, 3));
 }
 
+LIPM::ZMPTracking::ZMPTracking(int timesteps)
+  : zmp_targets(timesteps + 1, Eigen::Vector2d::Zero())
+  , zmp_weights(timesteps + 1, 0.)
+  , jerk_targets(timesteps, Eigen::Vector2d::Zero())
+  , jerk_weights(timesteps, 0.)
+{
+}
+
+bool LIPM::solve_zmp_tracking(const ZMPTracking& tracking, double omega_2, std::vector<Eigen::Vector2d>& zmp)
+{
+  // Discrete dynamics s_{k+1} = A s_k + B j_k, with s = [pos, vel, acc], and zmp = c^T s
+  Eigen::Matrix3d A = x.A;
+  Eigen::Vector3d B = x.B;
+  Eigen::Vector3d c(1., 0., -1. / omega_2);
+
+  // The value function is 1/2 s^T S s + s^T (v + Lambda lambda), where lambda are the multipliers of the final
+  // state constraint. Both axes share S and the gains, only the affine terms differ (one column per axis)
+  Eigen::Matrix3d S = tracking.zmp_weights[timesteps] * c * c.transpose();
+  Eigen::Matrix<double, 3, 2> v = -c * (tracking.zmp_weights[timesteps] * tracking.zmp_targets[timesteps].transpose());
+  Eigen::Matrix3d Lambda = Eigen::Matrix3d::Identity();
+
+  std::vector<Eigen::RowVector3d> K(timesteps);
+  std::vector<Eigen::RowVector2d> k_ff(timesteps);
+  std::vector<Eigen::RowVector3d> K_lambda(timesteps);
+
+  for (int k = timesteps - 1; k >= 0; k--)
+  {
+    Eigen::RowVector3d Q_ux = B.transpose() * S * A;
+    double Q_uu = tracking.jerk_weights[k] + tracking.regularization + B.dot(S * B);
+    Eigen::RowVector2d Q_u = B.transpose() * v - tracking.jerk_weights[k] * tracking.jerk_targets[k].transpose();
+
+    K[k] = -Q_ux / Q_uu;
+    k_ff[k] = -Q_u / Q_uu;
+    K_lambda[k] = -(B.transpose() * Lambda) / Q_uu;
+
+    S = tracking.zmp_weights[k] * c * c.transpose() + A.transpose() * S * A + Q_ux.transpose() * K[k];
+    v = -c * (tracking.zmp_weights[k] * tracking.zmp_targets[k].transpose()) + A.transpose() * v +
+        Q_ux.transpose() * k_ff[k];
+    Lambda = A.transpose() * Lambda + Q_ux.transpose() * K_lambda[k];
+  }
+
+  Eigen::Matrix<double, 3, 2> X0;
+  X0.col(0) = x.X0.b;
+  X0.col(1) = y.X0.b;
+
+  // The final state is affine in the multipliers: s_N = e + F lambda
+  Eigen::Matrix<double, 3, 2> lambda = Eigen::Matrix<double, 3, 2>::Zero();
+
+  if (tracking.final_constraint)
+  {
+    Eigen::Matrix<double, 3, 2> e = X0;
+    Eigen::Matrix3d F = Eigen::Matrix3d::Zero();
+
+    for (int k = 0; k < timesteps; k++)
+    {
+      e = A * e + B * (K[k] * e + k_ff[k]);
+      F = A * F + B * (K[k] * F + K_lambda[k]);
+    }
+
+    Eigen::FullPivLU<Eigen::Matrix3d> lu(F);
+    if (lu.rank() < 3)
+    {
+      return false;
+    }
+
+    Eigen::Matrix<double, 3, 2> target;
+    target << tracking.final_pos.transpose(), tracking.final_vel.transpose(), tracking.final_acc.transpose();
+    lambda = lu.solve(target - e);
+  }
+
+  // Rolling out the optimal jerks
+  Eigen::Matrix<double, 3, 2> state = X0;
+  Eigen::VectorXd x_jerks(timesteps);
+  Eigen::VectorXd y_jerks(timesteps);
+  zmp.resize(timesteps + 1);
+
+  for (int k = 0; k < timesteps; k++)
+  {
+    zmp[k] = state.transpose() * c;
+
+    Eigen::RowVector2d jerk = K[k] * state + k_ff[k] + K_lambda[k] * lambda;
+    x_jerks[k] = jerk[0];
+    y_jerks[k] = jerk[1];
+
+    state = A * state + B * jerk;
+  }
+  zmp[timesteps] = state.transpose() * c;
+
+  x_var->value = x_jerks;
+  y_var->value = y_jerks;
+  x_var->version += 1;
+  y_var->version += 1;
+
+  return true;
+}
+
 double LIPM::compute_omega(double com_height)
 {
   return sqrt(9.80665 / com_height);
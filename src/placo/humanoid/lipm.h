@@ -27,6 +27,44 @@ public:
     problem::Integrator::Trajectory y;
   };
 
+  /**
+   * @brief A ZMP tracking problem, whose cost is:
+   *
+   * \f$\sum_k \frac{w_k}{2} ||zmp_k - zmp^*_k||^2 + \frac{\rho_k}{2} ||jerk_k - jerk^*_k||^2 + \frac{\epsilon}{2}
+   * ||jerk_k||^2\f$
+   *
+   * Optionally, the final state can be constrained. See \ref solve_zmp_tracking
+   */
+  struct ZMPTracking
+  {
+    ZMPTracking(int timesteps);
+
+    /**
+     * @brief ZMP targets and weights, for each timestep (from 0 to timesteps, included)
+     */
+    std::vector<Eigen::Vector2d> zmp_targets;
+    std::vector<double> zmp_weights;
+
+    /**
+     * @brief Jerk targets and weights, for each timestep (from 0 to timesteps, excluded)
+     */
+    std::vector<Eigen::Vector2d> jerk_targets;
+    std::vector<double> jerk_weights;
+
+    /**
+     * @brief Regularization \f$\epsilon\f$ on the jerks
+     */
+    double regularization = 1e-8;
+
+    /**
+     * @brief If true, the final state is constrained to final_pos, final_vel and final_acc
+     */
+    bool final_constraint = false;
+    Eigen::Vector2d final_pos = Eigen::Vector2d::Zero();
+    Eigen::Vector2d final_vel = Eigen::Vector2d::Zero();
+    Eigen::Vector2d final_acc = Eigen::Vector2d::Zero();
+  };
+
   LIPM(problem::Problem& problem, int timesteps, double dt, Eigen::Vector2d initial_pos,
        Eigen::Vector2d initial_vel = Eigen::Vector2d(0., 0.), Eigen::Vector2d initial_acc = Eigen::Vector2d(0., 0.));
 
@@ -41,6 +79,23 @@ public:
   problem::Expression zmp(int timestep, double omega_2);
   problem::Expression dzmp(int timestep, double omega_2);
 
+  /**
+   * @brief Solves a ZMP tracking problem without building any problem expression.
+   *
+   * Since the LIPM dynamics are time-invariant and the x and y axes are decoupled, this is a linear-quadratic problem
+   * solved with a Riccati recursion, in O(timesteps) time and memory. The final state constraint is enforced exactly
+   * by solving for its multipliers, the solution being affine in them. The jerks are written in the variables values,
+   * so that \ref get_trajectory can be used afterward.
+   *
+   * Note that this doesn't support inequality constraints, the returned ZMP trajectory can be used to check them.
+   *
+   * @param tracking the tracking problem
+   * @param omega_2 natural frequency squared
+   * @param zmp output ZMP for each timestep (from 0 to timesteps, included)
+   * @return false if the problem can't be solved this way (final state not reachable)
+   */
+  bool solve_zmp_tracking(const ZMPTracking& tracking, double omega_2, std::vector<Eigen::Vector2d>& zmp);
+
   /**
    * @brief Compute the natural frequency of a LIPM given its height (omega = sqrt(g / h))
    */
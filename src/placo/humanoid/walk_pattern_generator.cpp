@@ -20,6 +20,27 @@ WalkPatternGenerator::WalkPatternGenerator(HumanoidRobot& robot, HumanoidParamet
   omega_2 = pow(omega, 2);
 }
 
+// Checks that a point is inside a (clockwise) polygon, with a margin, as PolygonConstraint::in_polygon_xy does
+static bool _inPolygon(const Eigen::Vector2d& point, const std::vector<Eigen::Vector2d>& polygon, double margin)
+{
+  for (size_t i = 0; i < polygon.size(); i++)
+  {
+    const Eigen::Vector2d& A = polygon[i];
+    const Eigen::Vector2d& B = polygon[(i + 1) % polygon.size()];
+
+    // Normalized vector pointing inside the polygon
+    Eigen::Vector2d n((B - A).y(), (A - B).x());
+    n.normalize();
+
+    if (n.dot(point - A) - margin < -1e-6)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 static Eigen::Affine3d _buildFrame(Eigen::Vector3d position, double orientation)
 {
   Eigen::Affine3d frame = Eigen::Affine3d::Identity();
@@ -333,17 +354,26 @@ void WalkPatternGenerator::planCoM(Trajectory& trajectory, Eigen::Vector2d initi
 
   // Creating the planner
   Problem problem = Problem();
+  ExpressionPool::Scope expression_scope(problem.expression_pool);
   LIPM lipm = LIPM(problem, timesteps, parameters.dt(), initial_pos, initial_vel, initial_acc);
   lipm.t_start = trajectory.t_start;
 
-  // We ensure that the first tile of the old trajectory starts with the same jerks as initially planned
+  // Targets and ZMP polygons are first collected, so that the problem can be solved in closed form when the
+  // polygon constraints are not active
+  LIPM::ZMPTracking tracking(timesteps);
+  tracking.regularization = problem.regularization;
+  std::vector<std::pair<int, std::vector<Eigen::Vector2d>>> zmp_polygons;
+
+  // We ensure that the first tile of the old trajectory starts with the same jerks as initially planned. The kept
+  // timesteps can exceed the planned horizon, in that case only the jerks within the horizon are constrained (the
+  // jerk expressions beyond it don't exist)
   if (old_trajectory != nullptr)
   {
-    for (int timestep = 1; timestep < kept_timesteps; timestep++)
+    for (int timestep = 1; timestep < std::min(kept_timesteps, timesteps); timestep++)
     {
-      Eigen::Vector2d jerk = old_trajectory->get_j_world_CoM(trajectory.t_start + timestep * parameters.dt()).head(2);
-      problem.add_constraint(lipm.jerk(timestep) == jerk)
-          .configure(ProblemConstraint::Soft, 1e-4);
+      tracking.jerk_targets[timestep] =
+          old_trajectory->get_j_world_CoM(trajectory.t_start + timestep * parameters.dt()).head(2);
+      tracking.jerk_weights[timestep] = 1e-4;
     }
   }
 
@@ -354,14 +384,14 @@ void WalkPatternGenerator::planCoM(Trajectory& trajectory, Eigen::Vector2d initi
   {
     current_support = trajectory.supports[i];
     int step_timesteps = support_timesteps(current_support);
+    std::vector<Eigen::Vector2d> support_polygon = current_support.support_polygon();
 
     for (int timestep = constrained_timesteps; timestep < fmin(timesteps, constrained_timesteps + step_timesteps); timestep++)
     {
       // Ensuring ZMP remains in the support polygon
       if (timestep > kept_timesteps)
       {
-        problem.add_constraint(PolygonConstraint::in_polygon_xy(
-            lipm.zmp(timestep, omega_2), current_support.support_polygon(), parameters.zmp_margin));
+        zmp_polygons.push_back(std::make_pair(timestep, support_polygon));
       }
       
       // ZMP reference trajectory : aiming for the center of single supports
@@ -405,8 +435,8 @@ void WalkPatternGenerator::planCoM(Trajectory& trajectory, Eigen::Vector2d initi
         }
 
         Eigen::Vector3d zmp_target = current_support.frame() * Eigen::Vector3d(x_offset, y_offset, 0);
-        problem.add_constraint(lipm.zmp(timestep, omega_2) == zmp_target.head(2))
-            .configure(ProblemConstraint::Soft, parameters.zmp_reference_weight);
+        tracking.zmp_targets[timestep] = zmp_target.head(2);
+        tracking.zmp_weights[timestep] = parameters.zmp_reference_weight;
       }
     }
 
@@ -422,10 +452,57 @@ void WalkPatternGenerator::planCoM(Trajectory& trajectory, Eigen::Vector2d initi
   if (current_support.end)
   {
     // XXX: In the case we are not on an "end", maybe we want to target another final condition
-    problem.add_constraint(lipm.pos(timesteps) == Eigen::Vector2d(current_support.frame().translation().x(),
-                                                                  current_support.frame().translation().y()));
-    problem.add_constraint(lipm.vel(timesteps) == Eigen::Vector2d(0., 0.));
-    problem.add_constraint(lipm.acc(timesteps) == Eigen::Vector2d(0., 0.));
+    tracking.final_constraint = true;
+    tracking.final_pos = current_support.frame().translation().head(2);
+  }
+
+  // Fast path: if the unconstrained optimum keeps the ZMP in the support polygons, it is also the QP solution
+  std::vector<Eigen::Vector2d> zmp;
+  if (lipm.solve_zmp_tracking(tracking, omega_2, zmp))
+  {
+    bool zmp_in_polygons = true;
+    for (auto& zmp_polygon : zmp_polygons)
+    {
+      if (!_inPolygon(zmp[zmp_polygon.first], zmp_polygon.second, parameters.zmp_margin))
+      {
+        zmp_in_polygons = false;
+        break;
+      }
+    }
+
+    if (zmp_in_polygons)
+    {
+      trajectory.com = lipm.get_trajectory();
+      return;
+    }
+  }
+
+  // Otherwise, the full QP is built and solved
+  for (int timestep = 0; timestep < timesteps; timestep++)
+  {
+    if (tracking.jerk_weights[timestep] > 0)
+    {
+      problem.add_constraint(lipm.jerk(timestep) == tracking.jerk_targets[timestep])
+          .configure(ProblemConstraint::Soft, tracking.jerk_weights[timestep]);
+    }
+    if (tracking.zmp_weights[timestep] > 0)
+    {
+      problem.add_constraint(lipm.zmp(timestep, omega_2) == tracking.zmp_targets[timestep])
+          .configure(ProblemConstraint::Soft, tracking.zmp_weights[timestep]);
+    }
+  }
+
+  for (auto& zmp_polygon : zmp_polygons)
+  {
+    problem.add_constraint(PolygonConstraint::in_polygon_xy(lipm.zmp(zmp_polygon.first, omega_2), zmp_polygon.second,
+                                                            parameters.zmp_margin));
+  }
+
+  if (tracking.final_constraint)
+  {
+    problem.add_constraint(lipm.pos(timesteps) == tracking.final_pos);
+    problem.add_constraint(lipm.vel(timesteps) == tracking.final_vel);
+    problem.add_constraint(lipm.acc(timesteps) == tracking.final_acc);
   }
 
   problem.solve();
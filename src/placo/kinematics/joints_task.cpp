@@ -12,6 +12,11 @@ void JointsTask::set_joint(std::string joint, double target)
   joints[joint] = target;
 }
 
+void JointsTask::set_joint(model::RobotWrapper::JointIndex joint, double target)
+{
+  indexed_joints[joint] = target;
+}
+
 double JointsTask::get_joint(std::string joint)
 {
   if (!joints.count(joint))
@@ -22,14 +27,37 @@ double JointsTask::get_joint(std::string joint)
   return joints[joint];
 }
 
+double JointsTask::get_joint(model::RobotWrapper::JointIndex joint)
+{
+  if (!indexed_joints.count(joint))
+  {
+    throw std::runtime_error("Joint " + std::to_string(joint) + " not found in task");
+  }
+
+  return indexed_joints[joint];
+}
+
 void JointsTask::update()
 {
-  A = Eigen::MatrixXd(joints.size(), solver->N);
-  b = Eigen::MatrixXd(joints.size(), 1);
+  A = Eigen::MatrixXd(joints.size() + indexed_joints.size(), solver->N);
+  b = Eigen::MatrixXd(joints.size() + indexed_joints.size(), 1);
   A.setZero();
 
   int k = 0;
   for (auto& entry : joints)
+  {
+    if (indexed_joints.count(solver->robot.get_joint_index(entry.first)))
+    {
+      throw std::runtime_error("Joint '" + entry.first + "' is set both by name and by index in joints task");
+    }
+
+    A(k, solver->robot.get_joint_v_offset(entry.first)) = 1;
+    b(k, 0) = entry.second - solver->robot.get_joint(entry.first);
+
+    k += 1;
+  }
+
+  for (auto& entry : indexed_joints)
   {
     A(k, solver->robot.get_joint_v_offset(entry.first)) = 1;
     b(k, 0) = entry.second - solver->robot.get_joint(entry.first);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "placo/kinematics/task.h"
+#include "placo/model/robot_wrapper.h"
 
 namespace placo::kinematics
 {
@@ -17,6 +18,13 @@ struct JointsTask : public Task
    */
   std::map<std::string, double> joints;
 
+  /**
+   * @brief Joint indices (see \ref model::RobotWrapper::get_joint_index) to target values mapping. Unlike
+   * \ref joints, no name look-up is needed when the task is updated. A joint can't be set both by name and by index,
+   * the task update raises an error in this case.
+   */
+  std::map<model::RobotWrapper::JointIndex, double> indexed_joints;
+
   /**
    * @brief Sets a joint target
    * @param joint joint
@@ -24,6 +32,13 @@ struct JointsTask : public Task
    */
   void set_joint(std::string joint, double target);
 
+  /**
+   * @brief Sets a joint target, using its index
+   * @param joint joint index
+   * @param target target value
+   */
+  void set_joint(model::RobotWrapper::JointIndex joint, double target);
+
   /**
    * @brief Returns the target value of a joint
    * @param joint joint
@@ -31,6 +46,13 @@ struct JointsTask : public Task
    */
   double get_joint(std::string joint);
 
+  /**
+   * @brief Returns the target value of a joint, using its index
+   * @param joint joint index
+   * @return target value
+   */
+  double get_joint(model::RobotWrapper::JointIndex joint);
+
   virtual void update();
   virtual std::string type_name();
   virtual std::string error_unit();
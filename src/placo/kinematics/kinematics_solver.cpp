@@ -4,6 +4,7 @@
 #include "placo/model/robot_wrapper.h"
 #include "placo/problem/problem.h"
 #include "placo/tools/utils.h"
+#include "placo/tools/thread_pool.h"
 
 namespace placo::kinematics
 {
@@ -12,7 +13,12 @@ using namespace placo::problem;
 KinematicsSolver::KinematicsSolver(model::RobotWrapper& robot_) : robot(robot_), masked_fbase(false)
 {
   N = robot.model.nv;
-  problem.use_sparsity = false;
+
+  // Tasks on frames declare the columns of their kinematic chain, so that the hessian is built from compact blocks
+  problem.use_sparsity = true;
+
+  // The problem is rebuilt at each solve with (usually) the same structure
+  problem.reuse_structure = true;
 }
 
 KinematicsSolver::~KinematicsSolver()
@@ -20,6 +26,52 @@ KinematicsSolver::~KinematicsSolver()
   clear();
 }
 
+const problem::Sparsity& KinematicsSolver::frame_sparsity(model::RobotWrapper::FrameIndex frame)
+{
+  auto it = frames_sparsity.find(frame);
+  if (it == frames_sparsity.end())
+  {
+    problem::Sparsity sparsity;
+    int start = -1;
+    int end = -1;
+
+    // Joints supporting the frame, from the root, with contiguous DoFs merged in one interval
+    for (auto joint : robot.model.supports[robot.model.frames[frame].parent])
+    {
+      int idx_v = robot.model.idx_vs[joint];
+      int nv = robot.model.nvs[joint];
+
+      if (nv == 0)
+      {
+        continue;
+      }
+
+      if (start != -1 && idx_v == end + 1)
+      {
+        end += nv;
+      }
+      else
+      {
+        if (start != -1)
+        {
+          sparsity.add_interval(start, end);
+        }
+        start = idx_v;
+        end = idx_v + nv - 1;
+      }
+    }
+
+    if (start != -1)
+    {
+      sparsity.add_interval(start, end);
+    }
+
+    it = frames_sparsity.emplace(frame, sparsity).first;
+  }
+
+  return it->second;
+}
+
 PositionTask& KinematicsSolver::add_position_task(model::RobotWrapper::FrameIndex frame, Eigen::Vector3d target_world)
 {
   return add_task(new PositionTask(frame, target_world));
@@ -284,6 +336,9 @@ Eigen::VectorXd KinematicsSolver::solve(bool apply)
   // Clear previously created constraints
   problem.clear_constraints();
 
+  // Expressions built for this solve are allocated from the problem pool
+  ExpressionPool::Scope expression_scope(problem.expression_pool);
+
   has_scaling = false;
 
   // Updating all the task matrices
@@ -294,6 +349,7 @@ Eigen::VectorXd KinematicsSolver::solve(bool apply)
     // Skipping empty tasks
     if (task->A.rows() == 0)
     {
+      task->problem_constraints_start = task->problem_constraints_end = 0;
       continue;
     }
 
@@ -335,7 +391,20 @@ Eigen::VectorXd KinematicsSolver::solve(bool apply)
       e.b = -task->b;
     }
 
-    problem.add_constraint(e == 0).configure(task_priority, task->weight);
+    task->problem_constraints_start = problem.constraints_count();
+    ProblemConstraint& task_constraint = problem.add_constraint(e == 0);
+    task_constraint.configure(task_priority, task->weight);
+    task_constraint.level = task->level;
+
+    if (!task->sparsity.intervals.empty())
+    {
+      task_constraint.sparsity = task->sparsity;
+      if (task->priority == Task::Priority::Scaled)
+      {
+        task_constraint.sparsity.add_interval(scale_variable->k_start, scale_variable->k_start);
+      }
+    }
+    task->problem_constraints_end = problem.constraints_count();
   }
 
   // Masked DoFs are hard equality constraints enforcing no deltas
@@ -353,11 +422,26 @@ Eigen::VectorXd KinematicsSolver::solve(bool apply)
 
   for (auto constraint : constraints)
   {
+    constraint->problem_constraints_start = problem.constraints_count();
     constraint->add_constraint(problem);
+    constraint->problem_constraints_end = problem.constraints_count();
+    problem.set_constraints_level(constraint->problem_constraints_start, constraint->problem_constraints_end,
+                                  constraint->level);
   }
 
   problem.solve();
 
+  // Retrieving the tasks and constraints Lagrange multipliers
+  for (auto task : tasks)
+  {
+    task->duals = problem.constraints_duals(task->problem_constraints_start, task->problem_constraints_end);
+  }
+  for (auto constraint : constraints)
+  {
+    constraint->duals =
+        problem.constraints_duals(constraint->problem_constraints_start, constraint->problem_constraints_end);
+  }
+
   // Retrieving qd (ignoring slack variables)
   Eigen::VectorXd qd_sol = qd->value;
 
@@ -383,6 +467,25 @@ Eigen::VectorXd KinematicsSolver::solve(bool apply)
   return qd_sol;
 }
 
+std::vector<Eigen::VectorXd> KinematicsSolver::solve_batch(const std::vector<KinematicsSolver*>& solvers, bool apply)
+{
+  std::set<model::RobotWrapper*> robots;
+  for (auto solver : solvers)
+  {
+    if (!robots.insert(&solver->robot).second)
+    {
+      throw std::runtime_error("KinematicsSolver::solve_batch: solvers in a batch should control distinct robots");
+    }
+  }
+
+  // Each solver owns its problem and robot data, they can be solved independently
+  std::vector<Eigen::VectorXd> solutions(solvers.size());
+  tools::ThreadPool::shared().run(solvers.size(),
+                                  [&](int index, int thread) { solutions[index] = solvers[index]->solve(apply); });
+
+  return solutions;
+}
+
 void KinematicsSolver::clear()
 {
   for (auto& task : tasks)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <map>
 #include <set>
 
 #include "placo/model/robot_wrapper.h"
@@ -314,6 +315,18 @@ public:
    * @return the vector containing delta q, which are target variations for the robot degrees of freedom.
    */
   Eigen::VectorXd solve(bool apply = false);
+
+  /**
+   * @brief Solves a batch of independent solvers in parallel, using the shared thread pool.
+   *
+   * The solvers (and the robots they control) should be distinct. The results are ordered as the solvers, and are
+   * the same as solving them one after another.
+   *
+   * @param solvers the solvers to solve
+   * @param apply apply the solutions to the robot models
+   * @return the delta q solutions of each solver
+   */
+  static std::vector<Eigen::VectorXd> solve_batch(const std::vector<KinematicsSolver*>& solvers, bool apply = false);
   /**
    * @brief Masks (disables a DoF) from being used by the QP solver (it can't provide speed)
    * @param dof the dof name
@@ -384,6 +397,14 @@ public:
    */
   int tasks_count();
 
+  /**
+   * @brief Columns of the frame jacobian that can be non-zero, i.e. the DoFs of the kinematic chain from the root to
+   * the frame
+   * @param frame the frame
+   * @return columns sparsity
+   */
+  const problem::Sparsity& frame_sparsity(model::RobotWrapper::FrameIndex frame);
+
   /**
    * @brief The robot controlled by this solver
    */
@@ -472,6 +493,9 @@ protected:
 
   void compute_limits_inequalities();
 
+  // Columns sparsity of the frames jacobians, that only depends on the robot structure
+  std::map<model::RobotWrapper::FrameIndex, problem::Sparsity> frames_sparsity;
+
   // Task id (this is only useful when task names are not specified, each task will have an unique ID)
   int task_id = 0;
   int constraint_id = 0;
@@ -1,5 +1,4 @@
 #include <Eigen/Dense>
-#include <unsupported/Eigen/MatrixFunctions>
 #include "placo/kinematics/kinetic_energy_regularization_task.h"
 #include "placo/kinematics/kinematics_solver.h"
 
@@ -7,11 +6,8 @@ namespace placo::kinematics
 {
 void KineticEnergyRegularizationTask::update()
 {
-  // Computing the mass matrix
-  Eigen::MatrixXd M = solver->robot.mass_matrix();
-
-  // Computing M^1/2
-  Eigen::MatrixXd M_1_2 = M.sqrt();
+  // Cholesky factor of the mass matrix, M = L L^T
+  Eigen::MatrixXd L = solver->robot.mass_matrix_cholesky();
 
   // We need dt so that this task has an energy unit
   if (solver->dt == 0.)
@@ -19,9 +15,9 @@ void KineticEnergyRegularizationTask::update()
     throw std::runtime_error("RegularizationTask::update: you should set solver.dt");
   }
 
-  // We want to minimize (1/2) * qd^T * M * qd
-  // Equality equation is M^1/2 / (dt * sqrt(2)) * delta_q = 0
-  A = M_1_2 / (sqrt(2) * solver->dt);
+  // We want to minimize (1/2) * qd^T * M * qd = (1/2) * || L^T qd ||^2
+  // Equality equation is L^T / (dt * sqrt(2)) * delta_q = 0
+  A = L.transpose() / (sqrt(2) * solver->dt);
   b = Eigen::VectorXd(solver->N);
   b.setZero();
 }
@@ -12,14 +12,17 @@ OrientationTask::OrientationTask(model::RobotWrapper::FrameIndex frame_index, Ei
 void OrientationTask::update()
 {
   auto T_world_frame = solver->robot.get_T_world_frame(frame_index);
-  Eigen::MatrixXd J, error;
+  Eigen::MatrixXd error;
 
   Eigen::Matrix3d M = (R_world_frame * T_world_frame.linear().transpose()).matrix();
   error = pinocchio::log3(M);
-  J = solver->robot.frame_jacobian(frame_index, pinocchio::WORLD);
+
+  Eigen::MatrixXd J(6, solver->robot.model.nv);
+  solver->robot.frame_jacobian(frame_index, pinocchio::WORLD, J);
 
   mask.R_local_world = R_world_frame.transpose();
   A = mask.apply(J.block(3, 0, 3, solver->N));
+  sparsity = solver->frame_sparsity(frame_index);
   b = mask.apply(error);
 }
 
@@ -13,9 +13,11 @@ void PositionTask::update()
   auto T_world_frame = solver->robot.get_T_world_frame(frame_index);
   mask.R_local_world = T_world_frame.linear().transpose();
   Eigen::Vector3d error = target_world - T_world_frame.translation();
-  Eigen::MatrixXd J = solver->robot.frame_jacobian(frame_index, pinocchio::LOCAL_WORLD_ALIGNED);
+  Eigen::MatrixXd J(6, solver->robot.model.nv);
+  solver->robot.frame_jacobian(frame_index, pinocchio::LOCAL_WORLD_ALIGNED, J);
 
   A = mask.apply(J.block(0, 0, 3, solver->N));
+  sparsity = solver->frame_sparsity(frame_index);
   b = mask.apply(error);
 }
 
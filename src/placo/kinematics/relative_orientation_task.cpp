@@ -25,6 +25,7 @@ void RelativeOrientationTask::update()
 
   A = mask.apply(Jlog * J_ab);
   b = mask.apply(error);
+  sparsity = solver->frame_sparsity(frame_a) + solver->frame_sparsity(frame_b);
 }
 
 std::string RelativeOrientationTask::type_name()
@@ -17,6 +17,7 @@ void RelativePositionTask::update()
 
   A = mask.apply(solver->robot.relative_position_jacobian(frame_a, frame_b));
   b = mask.apply(target - T_a_b.translation());
+  sparsity = solver->frame_sparsity(frame_a) + solver->frame_sparsity(frame_b);
 }
 
 std::string RelativePositionTask::type_name()
@@ -3,6 +3,7 @@
 #include <string>
 #include <Eigen/Dense>
 #include "placo/model/robot_wrapper.h"
+#include "placo/problem/sparsity.h"
 #include "placo/tools/prioritized.h"
 #include "placo/tools/utils.h"
 
@@ -43,6 +44,12 @@ public:
    */
   Eigen::MatrixXd b;
 
+  /**
+   * @brief Columns of A that can be non-zero, which can be set by \ref update when it is known from the robot
+   * structure (if empty, it is detected by the problem)
+   */
+  problem::Sparsity sparsity;
+
   /**
    * @brief Update the task A and b matrices from the robot state and targets
    */
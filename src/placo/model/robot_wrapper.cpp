@@ -7,18 +7,130 @@
 #include "pinocchio/algorithm/rnea.hpp"
 #include "pinocchio/algorithm/crba.hpp"
 #include "pinocchio/algorithm/centroidal.hpp"
+#include "hpp/fcl/BVH/BVH_model.h"
 // Following includes will be required for Pinocchio 3:
 // #include "pinocchio/collision/collision.hpp"
 // #include "pinocchio/collision/distance.hpp"
 #include "placo/tools/utils.h"
+#include "placo/tools/thread_pool.h"
+#include <Eigen/Cholesky>
 #include <json/json.h>
 #include <filesystem>
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <fstream>
+#include <set>
+#include <atomic>
 
 namespace fs = std::filesystem;
 
 namespace placo::model
 {
+// Models of the robots loaded with the MODEL_CACHE flag, with the stamps (size and modification time) of the meshes
+// they were loaded from
+struct CachedModel
+{
+  pinocchio::Model model;
+  pinocchio::GeometryModel collision_model;
+  pinocchio::GeometryModel visual_model;
+  std::map<std::string, std::string> meshes_stamps;
+};
+
+// Cached models, indexed by model_cache_key. The oldest entry is dropped when the cache is full
+static const size_t model_cache_size = 8;
+static std::mutex model_cache_mutex;
+static std::map<std::string, std::shared_ptr<CachedModel>> model_cache;
+static std::deque<std::string> model_cache_order;
+
+static std::string read_file(const std::string& filename)
+{
+  std::ifstream f(filename);
+  std::stringstream buffer;
+  buffer << f.rdbuf();
+  return buffer.str();
+}
+
+// Key of a robot in the models cache: the directory, the flags and a hash of the URDF and collision pairs
+static std::string model_cache_key(const std::string& model_directory, int flags, const std::string& urdf)
+{
+  std::string collisions = read_file(model_directory + "/collisions.json");
+  size_t hash = std::hash<std::string>{}(urdf + collisions);
+
+  return model_directory + ":" + std::to_string(flags) + ":" + std::to_string(hash);
+}
+
+// Size and modification time of a file (empty if the file doesn't exist)
+static std::string file_stamp(const std::string& filename)
+{
+  std::error_code error;
+  auto size = fs::file_size(filename, error);
+  if (error)
+  {
+    return "";
+  }
+  auto time = fs::last_write_time(filename, error);
+
+  return std::to_string(size) + ":" + std::to_string(time.time_since_epoch().count());
+}
+
+// Stamps of the meshes used by the geometry models
+static std::map<std::string, std::string> meshes_stamps(const pinocchio::GeometryModel& collision_model,
+                                                        const pinocchio::GeometryModel& visual_model)
+{
+  std::map<std::string, std::string> stamps;
+  for (auto geometry_model : { &collision_model, &visual_model })
+  {
+    for (auto& object : geometry_model->geometryObjects)
+    {
+      if (object.meshPath != "")
+      {
+        stamps[object.meshPath] = file_stamp(object.meshPath);
+      }
+    }
+  }
+
+  return stamps;
+}
+
+// Cached model for the given key, if the meshes it was loaded from didn't change since then
+static std::shared_ptr<CachedModel> get_cached_model(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(model_cache_mutex);
+  if (!model_cache.count(key))
+  {
+    return nullptr;
+  }
+
+  std::shared_ptr<CachedModel> cached = model_cache[key];
+  for (auto& entry : cached->meshes_stamps)
+  {
+    if (file_stamp(entry.first) != entry.second)
+    {
+      return nullptr;
+    }
+  }
+
+  return cached;
+}
+
+static void set_cached_model(const std::string& key, std::shared_ptr<CachedModel> cached)
+{
+  std::lock_guard<std::mutex> lock(model_cache_mutex);
+  if (!model_cache.count(key))
+  {
+    model_cache_order.push_back(key);
+    if (model_cache_order.size() > model_cache_size)
+    {
+      model_cache.erase(model_cache_order.front());
+      model_cache_order.pop_front();
+    }
+  }
+  model_cache[key] = cached;
+}
+
 RobotWrapper::RobotWrapper(std::string model_directory, int flags, std::string urdf_content)
   : model_directory(model_directory)
 {
@@ -35,6 +147,68 @@ RobotWrapper::RobotWrapper(std::string model_directory, int flags, std::string u
     urdf_filename = model_directory + "/robot.urdf";
   }
 
+  // If the same robot was already loaded with the cache enabled, its models are copied instead of being parsed again
+  std::string cache_key;
+  std::shared_ptr<CachedModel> cached;
+  if (flags & MODEL_CACHE)
+  {
+    cache_key = model_cache_key(model_directory, flags, urdf_content != "" ? urdf_content : read_file(urdf_filename));
+    cached = get_cached_model(cache_key);
+  }
+
+  if (cached != nullptr)
+  {
+    model = cached->model;
+    collision_model = cached->collision_model;
+    visual_model = cached->visual_model;
+  }
+  else
+  {
+    load_models(model_directory, urdf_filename, flags, urdf_content);
+  }
+
+  // Creating data
+  data = new pinocchio::Data(model);
+  build_names_tables();
+  compute_collision_spheres();
+
+  if (flags & MODEL_CACHE && cached == nullptr)
+  {
+    cached = std::make_shared<CachedModel>();
+    cached->model = model;
+    cached->collision_model = collision_model;
+    cached->visual_model = visual_model;
+    cached->meshes_stamps = meshes_stamps(collision_model, visual_model);
+    set_cached_model(cache_key, cached);
+  }
+  else if (cached != nullptr)
+  {
+    // The robot was already checked when it was loaded
+    flags |= SKIP_COLLISIONS_CHECK;
+  }
+
+  reset();
+  pinocchio::computeAllTerms(model, *data, state.q, state.qd);
+  update_kinematics();
+
+  if (!(flags & SKIP_COLLISIONS_CHECK))
+  {
+    auto collisions = self_collisions();
+    if (collisions.size() > 0)
+    {
+      std::cerr << "WARNING: Robot has the following self collisions in neutral position:" << std::endl;
+
+      for (auto& collision : collisions)
+      {
+        std::cerr << "  -" << collision.bodyA << " collides with " << collision.bodyB << std::endl;
+      }
+    }
+  }
+}
+
+void RobotWrapper::load_models(const std::string& model_directory, const std::string& urdf_filename, int flags,
+                               const std::string& urdf_content)
+{
   if (urdf_content != "")
   {
     pinocchio::urdf::buildModelFromXML(urdf_content, root_joint, model);
@@ -72,6 +246,20 @@ RobotWrapper::RobotWrapper(std::string model_directory, int flags, std::string u
     }
   }
 
+  if (flags & CONVEX_COLLISIONS)
+  {
+    // Replacing the collision meshes with their convex hulls
+    for (auto& object : collision_model.geometryObjects)
+    {
+      auto mesh = std::dynamic_pointer_cast<hpp::fcl::BVHModelBase>(object.geometry);
+      if (mesh != nullptr)
+      {
+        mesh->buildConvexHull(false, "Qt");
+        object.geometry = mesh->convex;
+      }
+    }
+  }
+
   // Load collisions pairs
   if (!(flags & IGNORE_COLLISIONS))
   {
@@ -85,9 +273,6 @@ RobotWrapper::RobotWrapper(std::string model_directory, int flags, std::string u
     }
   }
 
-  // Creating data
-  data = new pinocchio::Data(model);
-
   // Assuming that motors with limits both equals to zero are not defined in the
   // URDF, setting them to the maximum possible value
   for (int k = 0; k < model.nq; k++)
@@ -98,21 +283,86 @@ RobotWrapper::RobotWrapper(std::string model_directory, int flags, std::string u
       model.upperPositionLimit[k] = std::numeric_limits<double>::max();
     }
   }
+}
 
-  reset();
-  pinocchio::computeAllTerms(model, *data, state.q, state.qd);
-  update_kinematics();
+void RobotWrapper::clear_model_cache()
+{
+  std::lock_guard<std::mutex> lock(model_cache_mutex);
+  model_cache.clear();
+  model_cache_order.clear();
+}
 
-  auto collisions = self_collisions();
-  if (collisions.size() > 0)
-  {
-    std::cerr << "WARNING: Robot has the following self collisions in neutral position:" << std::endl;
+RobotWrapper::RobotWrapper(const RobotWrapper& other)
+  : state(other.state)
+  , parallel_collisions(other.parallel_collisions)
+  , model_directory(other.model_directory)
+  , model(other.model)
+  , collision_model(other.collision_model)
+  , visual_model(other.visual_model)
+  , root_joint(other.root_joint)
+  , joints_indices(other.joints_indices)
+  , frames_indices(other.frames_indices)
+  , collision_spheres(other.collision_spheres)
+  , kinematics_q(other.kinematics_q)
+  , kinematics_qd(other.kinematics_qd)
+  , placements_updated(other.placements_updated)
+  , jacobians_updated(other.jacobians_updated)
+  , jacobians_time_variation_updated(other.jacobians_time_variation_updated)
+  , com_updated(other.com_updated)
+  , mass_matrix_updated(other.mass_matrix_updated)
+  , mass_matrix_cholesky_updated(other.mass_matrix_cholesky_updated)
+  , cached_mass_matrix(other.cached_mass_matrix)
+  , cached_mass_matrix_cholesky(other.cached_mass_matrix_cholesky)
+  , kinematics_version(other.kinematics_version)
+  , joints_jacobians(other.joints_jacobians)
+  , joints_jacobians_version(other.joints_jacobians_version)
+{
+  data = new pinocchio::Data(*other.data);
+}
 
-    for (auto& collision : collisions)
-    {
-      std::cerr << "  -" << collision.bodyA << " collides with " << collision.bodyB << std::endl;
-    }
+RobotWrapper& RobotWrapper::operator=(const RobotWrapper& other)
+{
+  if (this != &other)
+  {
+    state = other.state;
+    parallel_collisions = other.parallel_collisions;
+    model_directory = other.model_directory;
+    model = other.model;
+    collision_model = other.collision_model;
+    visual_model = other.visual_model;
+    root_joint = other.root_joint;
+    joints_indices = other.joints_indices;
+    frames_indices = other.frames_indices;
+    collision_spheres = other.collision_spheres;
+    clear_collision_data();
+    kinematics_q = other.kinematics_q;
+    kinematics_qd = other.kinematics_qd;
+    placements_updated = other.placements_updated;
+    jacobians_updated = other.jacobians_updated;
+    jacobians_time_variation_updated = other.jacobians_time_variation_updated;
+    com_updated = other.com_updated;
+    mass_matrix_updated = other.mass_matrix_updated;
+    mass_matrix_cholesky_updated = other.mass_matrix_cholesky_updated;
+    cached_mass_matrix = other.cached_mass_matrix;
+    cached_mass_matrix_cholesky = other.cached_mass_matrix_cholesky;
+    kinematics_version = other.kinematics_version;
+    joints_jacobians = other.joints_jacobians;
+    joints_jacobians_version = other.joints_jacobians_version;
+    *data = *other.data;
   }
+
+  return *this;
+}
+
+RobotWrapper::~RobotWrapper()
+{
+  delete data;
+  delete collision_data;
+}
+
+std::vector<RobotWrapper> RobotWrapper::make_contexts(int count)
+{
+  return std::vector<RobotWrapper>(count, *this);
 }
 
 bool RobotWrapper::Collision::operator==(const Collision& other)
@@ -132,14 +382,55 @@ void RobotWrapper::reset()
 
 pinocchio::FrameIndex RobotWrapper::get_frame_index(const std::string& frame)
 {
-  if (!model.existFrame(frame))
+  auto it = frames_indices.find(frame);
+  if (it == frames_indices.end())
   {
     std::ostringstream oss;
     oss << "Frame with name " << frame << " not found in model";
     throw std::runtime_error(oss.str());
   }
 
-  return model.getFrameId(frame);
+  return it->second;
+}
+
+void RobotWrapper::check_joint_index(JointIndex joint)
+{
+  // The universe (0) and root (1) joints are not actuated joints
+  if (joint < 2 || joint >= (JointIndex)model.njoints)
+  {
+    std::ostringstream oss;
+    oss << "Joint index " << joint << " is not a valid joint index (should be in [2, " << model.njoints << "[)";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+RobotWrapper::JointIndex RobotWrapper::get_joint_index(const std::string& name)
+{
+  auto it = joints_indices.find(name);
+  if (it == joints_indices.end())
+  {
+    std::ostringstream oss;
+    oss << "Joint with name " << name << " not found in model";
+    throw std::runtime_error(oss.str());
+  }
+
+  return it->second;
+}
+
+void RobotWrapper::build_names_tables()
+{
+  joints_indices.clear();
+  for (JointIndex joint = 0; joint < (JointIndex)model.njoints; joint++)
+  {
+    joints_indices.emplace(model.names[joint], joint);
+  }
+
+  // If several frames have the same name, the first one is kept (like pinocchio's getFrameId)
+  frames_indices.clear();
+  for (FrameIndex frame = 0; frame < model.frames.size(); frame++)
+  {
+    frames_indices.emplace(model.frames[frame].name, frame);
+  }
 }
 
 void RobotWrapper::set_joint(const std::string& name, double value)
@@ -147,26 +438,41 @@ void RobotWrapper::set_joint(const std::string& name, double value)
   state.q[get_joint_offset(name)] = value;
 }
 
+void RobotWrapper::set_joint(JointIndex joint, double value)
+{
+  state.q[get_joint_offset(joint)] = value;
+}
+
 double RobotWrapper::get_joint(const std::string& name)
 {
   return state.q[get_joint_offset(name)];
 }
 
+double RobotWrapper::get_joint(JointIndex joint)
+{
+  return state.q[get_joint_offset(joint)];
+}
+
 int RobotWrapper::get_joint_offset(const std::string& name)
 {
-  if (!model.existJointName(name))
-  {
-    std::ostringstream oss;
-    oss << "Joint with name " << name << " not found in model";
-    throw std::runtime_error(oss.str());
-  }
+  return get_joint_offset(get_joint_index(name));
+}
 
-  return 7 + model.getJointId(name) - 2;
+int RobotWrapper::get_joint_offset(JointIndex joint)
+{
+  check_joint_index(joint);
+  return model.idx_qs[joint];
 }
 
 int RobotWrapper::get_joint_v_offset(const std::string& name)
 {
-  return 6 + model.getJointId(name) - 2;
+  return get_joint_v_offset(get_joint_index(name));
+}
+
+int RobotWrapper::get_joint_v_offset(JointIndex joint)
+{
+  check_joint_index(joint);
+  return model.idx_vs[joint];
 }
 
 double RobotWrapper::get_joint_velocity(const std::string& name)
@@ -247,21 +553,85 @@ void RobotWrapper::set_T_world_fbase(Eigen::Affine3d transformation)
 
 Eigen::Vector3d RobotWrapper::com_world()
 {
-  pinocchio::centerOfMass(model, *data);
+  update_placements();
+
+  if (!com_updated)
+  {
+    pinocchio::centerOfMass(model, *data);
+    com_updated = true;
+  }
 
   return data->com[0];
 }
 
 void RobotWrapper::update_kinematics()
 {
-  pinocchio::framesForwardKinematics(model, *data, state.q);
-  pinocchio::computeJointJacobians(model, *data, state.q);
-  pinocchio::computeJointJacobiansTimeVariation(model, *data, state.q, state.qd);
-  pinocchio::updateFramePlacements(model, *data);
+  check_state();
+}
+
+void RobotWrapper::check_state()
+{
+  if (kinematics_q.rows() != state.q.rows() || kinematics_q != state.q)
+  {
+    kinematics_q = state.q;
+    kinematics_version += 1;
+    placements_updated = false;
+    jacobians_updated = false;
+    jacobians_time_variation_updated = false;
+    com_updated = false;
+    mass_matrix_updated = false;
+    mass_matrix_cholesky_updated = false;
+  }
+
+  if (kinematics_qd.rows() != state.qd.rows() || kinematics_qd != state.qd)
+  {
+    kinematics_qd = state.qd;
+    jacobians_time_variation_updated = false;
+  }
+}
+
+void RobotWrapper::update_placements()
+{
+  check_state();
+
+  if (!placements_updated)
+  {
+    pinocchio::framesForwardKinematics(model, *data, state.q);
+    placements_updated = true;
+  }
+}
+
+void RobotWrapper::update_jacobians()
+{
+  check_state();
+
+  if (!jacobians_updated)
+  {
+    pinocchio::computeJointJacobians(model, *data, state.q);
+    pinocchio::updateFramePlacements(model, *data);
+    jacobians_updated = true;
+    placements_updated = true;
+  }
+}
+
+void RobotWrapper::update_jacobians_time_variation()
+{
+  check_state();
+
+  if (!jacobians_time_variation_updated)
+  {
+    // This also computes the joints jacobians
+    pinocchio::computeJointJacobiansTimeVariation(model, *data, state.q, state.qd);
+    pinocchio::updateFramePlacements(model, *data);
+    jacobians_time_variation_updated = true;
+    jacobians_updated = true;
+    placements_updated = true;
+  }
 }
 
 void RobotWrapper::compute_hessians()
 {
+  update_jacobians();
   pinocchio::computeJointKinematicHessians(model, *data);
 }
 
@@ -308,6 +678,7 @@ void RobotWrapper::load_collision_pairs(const std::string& filename)
   }
 
   collision_model.removeAllCollisionPairs();
+  clear_collision_data();
 
   std::ifstream f(filename);
   if (!f.is_open())
@@ -358,6 +729,130 @@ void RobotWrapper::load_collision_pairs(const std::string& filename)
   }
 }
 
+void RobotWrapper::save_collision_pairs(const std::string& filename)
+{
+  Json::Value collisions(Json::arrayValue);
+
+  // Number of collision objects of each body, and pairs of objects for each pair of bodies (sorted, since
+  // load_collision_pairs adds all the objects pairs of the bodies given by name)
+  std::map<std::string, size_t> body_objects;
+  std::map<std::pair<std::string, std::string>, std::set<std::pair<size_t, size_t>>> bodies_pairs;
+  auto body_name = [&](size_t object) -> std::string {
+    FrameIndex frame = collision_model.geometryObjects[object].parentFrame;
+    return frame == std::numeric_limits<FrameIndex>::max() ? "" : model.frames[frame].name;
+  };
+
+  for (size_t k = 0; k < collision_model.geometryObjects.size(); k++)
+  {
+    if (body_name(k) != "")
+    {
+      body_objects[body_name(k)] += 1;
+    }
+  }
+
+  for (auto& pair : collision_model.collisionPairs)
+  {
+    std::pair<size_t, size_t> objects = std::minmax(pair.first, pair.second);
+    bodies_pairs[std::minmax(body_name(objects.first), body_name(objects.second))].insert(objects);
+  }
+
+  // Pairs are written with body names when all the pairs of the objects of both bodies are kept (several collision
+  // objects of the same bodies then yield only one entry), else with their objects indices
+  std::set<std::pair<std::string, std::string>> written_bodies_pairs;
+  for (auto& pair : collision_model.collisionPairs)
+  {
+    std::pair<std::string, std::string> bodies = std::minmax(body_name(pair.first), body_name(pair.second));
+    Json::Value entry(Json::arrayValue);
+
+    if (bodies.first != "" && bodies.first != bodies.second &&
+        bodies_pairs[bodies].size() == body_objects[bodies.first] * body_objects[bodies.second])
+    {
+      if (written_bodies_pairs.insert(bodies).second)
+      {
+        entry.append(bodies.first);
+        entry.append(bodies.second);
+        collisions.append(entry);
+      }
+    }
+    else
+    {
+      entry.append((int)pair.first);
+      entry.append((int)pair.second);
+      collisions.append(entry);
+    }
+  }
+
+  std::ofstream f(filename);
+  if (!f.is_open())
+  {
+    throw std::runtime_error("Can't save collision pairs");
+  }
+  f << collisions;
+}
+
+int RobotWrapper::prune_collision_pairs(int samples)
+{
+  if (samples < 1)
+  {
+    throw std::runtime_error("prune_collision_pairs: samples should be at least 1");
+  }
+
+  State state_save = state;
+  std::vector<int> collisions(collision_model.collisionPairs.size(), 0);
+
+  // The floating base (configuration of the root joint) and the joints without limits are not sampled
+  int root_start = model.idx_qs[1];
+  int root_end = root_start + model.nqs[1];
+  Eigen::VectorXd neutral = pinocchio::neutral(model);
+  Eigen::VectorXd lower = model.lowerPositionLimit;
+  Eigen::VectorXd upper = model.upperPositionLimit;
+  for (int k = 0; k < model.nq; k++)
+  {
+    if ((k >= root_start && k < root_end) || lower(k) == std::numeric_limits<double>::lowest() || upper(k) == std::numeric_limits<double>::max())
+    {
+      lower(k) = neutral(k);
+      upper(k) = neutral(k);
+    }
+  }
+
+  for (int sample = 0; sample < samples; sample++)
+  {
+    state.q = pinocchio::randomConfiguration(model, lower, upper);
+    update_collision_data();
+
+    for (size_t k = 0; k < collisions.size(); k++)
+    {
+      Collision collision;
+      if (compute_collision(*collision_data, k, collision))
+      {
+        collisions[k] += 1;
+      }
+    }
+  }
+
+  state = state_save;
+
+  // Keeping only the pairs that sometimes collide
+  std::vector<pinocchio::CollisionPair> pairs;
+  for (size_t k = 0; k < collisions.size(); k++)
+  {
+    if (collisions[k] > 0 && collisions[k] < samples)
+    {
+      pairs.push_back(collision_model.collisionPairs[k]);
+    }
+  }
+
+  int removed = collision_model.collisionPairs.size() - pairs.size();
+  collision_model.removeAllCollisionPairs();
+  for (auto& pair : pairs)
+  {
+    collision_model.addCollisionPair(pair);
+  }
+  clear_collision_data();
+
+  return removed;
+}
+
 Eigen::Affine3d RobotWrapper::get_T_world_frame(const std::string& frame)
 {
   return get_T_world_frame(get_frame_index(frame));
@@ -365,6 +860,8 @@ Eigen::Affine3d RobotWrapper::get_T_world_frame(const std::string& frame)
 
 Eigen::Affine3d RobotWrapper::get_T_world_frame(pinocchio::FrameIndex index)
 {
+  update_placements();
+
   return tools::pin_se3_to_eigen(data->oMf[index]);
 }
 
@@ -392,40 +889,206 @@ void RobotWrapper::set_T_world_frame(pinocchio::FrameIndex frame, Eigen::Affine3
   set_T_world_fbase(T_world_frameTarget * T_frame_fbase);
 }
 
-std::vector<RobotWrapper::Collision> RobotWrapper::self_collisions(bool stop_at_first)
+void RobotWrapper::compute_collision_spheres()
 {
-  std::vector<Collision> collisions;
-  pinocchio::GeometryData geom_data(collision_model);
+  collision_spheres.clear();
 
-  // And test all the collision pairs
-  pinocchio::computeCollisions(model, *data, collision_model, geom_data, state.q);
+  for (auto& object : collision_model.geometryObjects)
+  {
+    object.geometry->computeLocalAABB();
+
+    BoundingSphere sphere;
+    sphere.center = object.geometry->aabb_center;
+    sphere.radius = object.geometry->aabb_radius;
+    collision_spheres.push_back(sphere);
+  }
+}
+
+void RobotWrapper::clear_collision_data()
+{
+  delete collision_data;
+  collision_data = nullptr;
+  workers_collision_data.clear();
+}
 
-  // Print the status of all the collision pairs
-  for (size_t k = 0; k < collision_model.collisionPairs.size(); ++k)
+void RobotWrapper::update_collision_data()
+{
+  // The collision data is cleared by clear_collision_data() when the collision pairs change
+  if (collision_data == nullptr)
   {
-    const pinocchio::CollisionPair& cp = collision_model.collisionPairs[k];
-    const hpp::fcl::CollisionResult& cr = geom_data.collisionResults[k];
+    collision_data = new pinocchio::GeometryData(collision_model);
+
+    for (auto& request : collision_data->distanceRequests)
+    {
+      request.enable_cached_gjk_guess = true;
+    }
+  }
+
+  update_placements();
+  pinocchio::updateGeometryPlacements(model, *data, collision_model, *collision_data);
+}
+
+double RobotWrapper::bounding_spheres_distance(const pinocchio::CollisionPair& pair)
+{
+  const BoundingSphere& sphere_a = collision_spheres[pair.first];
+  const BoundingSphere& sphere_b = collision_spheres[pair.second];
+
+  Eigen::Vector3d center_a = collision_data->oMg[pair.first].act(sphere_a.center);
+  Eigen::Vector3d center_b = collision_data->oMg[pair.second].act(sphere_b.center);
+
+  return (center_b - center_a).norm() - sphere_a.radius - sphere_b.radius;
+}
+
+bool RobotWrapper::compute_collision(pinocchio::GeometryData& geometry_data, int pair, Collision& collision)
+{
+  const pinocchio::CollisionPair& cp = collision_model.collisionPairs[pair];
+
+  // Pairs whose bounding spheres don't overlap can't collide
+  if (!collision_data->activeCollisionPairs[pair] || bounding_spheres_distance(cp) > 0)
+  {
+    return false;
+  }
+
+  if (!pinocchio::computeCollision(collision_model, geometry_data, pair))
+  {
+    return false;
+  }
+
+  const hpp::fcl::CollisionResult& cr = geometry_data.collisionResults[pair];
+
+  collision.objA = cp.first;
+  collision.objB = cp.second;
+  collision.bodyA = collision_model.geometryObjects[cp.first].name;
+  collision.parentA = collision_model.geometryObjects[cp.first].parentJoint;
+  collision.bodyB = collision_model.geometryObjects[cp.second].name;
+  collision.parentB = collision_model.geometryObjects[cp.second].parentJoint;
+
+  for (size_t k = 0; k < cr.numContacts(); k++)
+  {
+    collision.contacts.push_back(Eigen::Vector3d(cr.getContact(k).pos));
+  }
+
+  return true;
+}
+
+bool RobotWrapper::compute_distance(pinocchio::GeometryData& geometry_data, int pair, double max_distance,
+                                    Distance& distance)
+{
+  const pinocchio::CollisionPair& cp = collision_model.collisionPairs[pair];
+
+  // Broad phase, skipping the pairs that are too far apart
+  if (!collision_data->activeCollisionPairs[pair] || bounding_spheres_distance(cp) > max_distance)
+  {
+    return false;
+  }
+
+  // The guesses are stored in the main collision data, since the pairs can be computed by any worker
+  if (&geometry_data != collision_data)
+  {
+    geometry_data.distanceRequests[pair] = collision_data->distanceRequests[pair];
+  }
+
+  const hpp::fcl::DistanceResult& dr = pinocchio::computeDistance(collision_model, geometry_data, pair);
+
+  // The current nearest points are used as initial guess for the next call
+  collision_data->distanceRequests[pair].updateGuess(dr);
+
+  distance.objA = cp.first;
+  distance.objB = cp.second;
+  distance.min_distance = dr.min_distance;
+  distance.pointA = dr.nearest_points[0];
+  distance.pointB = dr.nearest_points[1];
+  distance.parentA = collision_model.geometryObjects[cp.first].parentJoint;
+  distance.parentB = collision_model.geometryObjects[cp.second].parentJoint;
+
+  return true;
+}
+
+void RobotWrapper::update_workers_collision_data(int workers)
+{
+  if ((int)workers_collision_data.size() != workers)
+  {
+    workers_collision_data.clear();
+    for (int worker = 0; worker < workers; worker++)
+    {
+      workers_collision_data.push_back(std::make_unique<pinocchio::GeometryData>(collision_model));
+    }
+  }
+
+  for (auto& worker_data : workers_collision_data)
+  {
+    worker_data->oMg = collision_data->oMg;
+  }
+}
+
+std::vector<RobotWrapper::Collision> RobotWrapper::self_collisions(bool stop_at_first)
+{
+  std::vector<Collision> collisions;
+  update_collision_data();
+  int pairs = collision_model.collisionPairs.size();
 
-    if (cr.isCollision())
+  if (!parallel_collisions)
+  {
+    // And test all the collision pairs
+    for (int k = 0; k < pairs; k++)
     {
       Collision collision;
+      if (compute_collision(*collision_data, k, collision))
+      {
+        collisions.push_back(collision);
+        if (stop_at_first)
+        {
+          break;
+        }
+      }
+    }
 
-      collision.objA = cp.first;
-      collision.objB = cp.second;
-      collision.bodyA = collision_model.geometryObjects[cp.first].name;
-      collision.parentA = collision_model.geometryObjects[cp.first].parentJoint;
-      collision.bodyB = collision_model.geometryObjects[cp.second].name;
-      collision.parentB = collision_model.geometryObjects[cp.second].parentJoint;
+    return collisions;
+  }
 
-      for (size_t k = 0; k < cr.numContacts(); k++)
+  tools::ThreadPool& pool = tools::ThreadPool::shared();
+  update_workers_collision_data(pool.size());
+
+  // Pairs are split in contiguous chunks, whose results are merged in order
+  int chunks = std::min(pairs, 4 * pool.size());
+  std::vector<std::vector<Collision>> chunks_collisions(chunks);
+
+  // With stop_at_first, pairs after the first collision found are skipped, the pairs before are still checked so
+  // that the result is the same as the sequential one
+  std::atomic<int> first_collision(pairs);
+
+  pool.run(chunks, [&](int chunk, int thread) {
+    for (int k = (pairs * chunk) / chunks; k < (pairs * (chunk + 1)) / chunks; k++)
+    {
+      if (stop_at_first && k > first_collision)
       {
-        collision.contacts.push_back(Eigen::Vector3d(cr.getContact(k).pos));
+        break;
       }
 
+      Collision collision;
+      if (compute_collision(*workers_collision_data[thread], k, collision))
+      {
+        chunks_collisions[chunk].push_back(collision);
+        if (stop_at_first)
+        {
+          int first = first_collision;
+          while (k < first && !first_collision.compare_exchange_weak(first, k))
+          {
+          }
+          break;
+        }
+      }
+    }
+  });
+
+  for (auto& chunk_collisions : chunks_collisions)
+  {
+    for (auto& collision : chunk_collisions)
+    {
       collisions.push_back(collision);
       if (stop_at_first)
       {
-        break;
+        return collisions;
       }
     }
   }
@@ -433,28 +1096,47 @@ std::vector<RobotWrapper::Collision> RobotWrapper::self_collisions(bool stop_at_
   return collisions;
 }
 
-std::vector<RobotWrapper::Distance> RobotWrapper::distances()
+std::vector<RobotWrapper::Distance> RobotWrapper::distances(double max_distance)
 {
   std::vector<Distance> distances;
-  pinocchio::GeometryData geom_data(collision_model);
-
-  // And test all the collision pairs
-  pinocchio::computeDistances(model, *data, collision_model, geom_data, state.q);
+  update_collision_data();
+  int pairs = collision_model.collisionPairs.size();
 
-  for (size_t k = 0; k < collision_model.collisionPairs.size(); ++k)
+  if (!parallel_collisions)
   {
-    const pinocchio::CollisionPair& cp = collision_model.collisionPairs[k];
-    const hpp::fcl::DistanceResult& dr = geom_data.distanceResults[k];
+    for (int k = 0; k < pairs; k++)
+    {
+      Distance distance;
+      if (compute_distance(*collision_data, k, max_distance, distance))
+      {
+        distances.push_back(distance);
+      }
+    }
 
-    Distance distance;
-    distance.objA = cp.first;
-    distance.objB = cp.second;
-    distance.min_distance = dr.min_distance;
-    distance.pointA = dr.nearest_points[0];
-    distance.pointB = dr.nearest_points[1];
-    distance.parentA = collision_model.geometryObjects[cp.first].parentJoint;
-    distance.parentB = collision_model.geometryObjects[cp.second].parentJoint;
-    distances.push_back(distance);
+    return distances;
+  }
+
+  tools::ThreadPool& pool = tools::ThreadPool::shared();
+  update_workers_collision_data(pool.size());
+
+  // Pairs are split in contiguous chunks, whose results are merged in order
+  int chunks = std::min(pairs, 4 * pool.size());
+  std::vector<std::vector<Distance>> chunks_distances(chunks);
+
+  pool.run(chunks, [&](int chunk, int thread) {
+    for (int k = (pairs * chunk) / chunks; k < (pairs * (chunk + 1)) / chunks; k++)
+    {
+      Distance distance;
+      if (compute_distance(*workers_collision_data[thread], k, max_distance, distance))
+      {
+        chunks_distances[chunk].push_back(distance);
+      }
+    }
+  });
+
+  for (auto& chunk_distances : chunks_distances)
+  {
+    distances.insert(distances.end(), chunk_distances.begin(), chunk_distances.end());
   }
 
   return distances;
@@ -487,15 +1169,61 @@ Eigen::MatrixXd RobotWrapper::frame_jacobian(const std::string& frame, const std
   return frame_jacobian(get_frame_index(frame), string_to_reference(reference));
 }
 
+// Expresses a WORLD jacobian in the given reference, for a frame with the given placement
+static void express_jacobian(const Eigen::MatrixXd& J_world, const pinocchio::SE3& placement,
+                             pinocchio::ReferenceFrame ref, Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+  jacobian = J_world;
+
+  if (ref != pinocchio::ReferenceFrame::WORLD)
+  {
+    // Linear velocity of the frame origin, v_frame = v_world - p x omega
+    jacobian.topRows(3).noalias() -= pinocchio::skew(placement.translation()) * J_world.bottomRows(3);
+
+    if (ref == pinocchio::ReferenceFrame::LOCAL)
+    {
+      jacobian.topRows(3) = placement.rotation().transpose() * jacobian.topRows(3);
+      jacobian.bottomRows(3) = placement.rotation().transpose() * jacobian.bottomRows(3);
+    }
+  }
+}
+
+const Eigen::MatrixXd& RobotWrapper::world_joint_jacobian(JointIndex joint)
+{
+  update_jacobians();
+
+  if ((int)joints_jacobians.size() != model.njoints)
+  {
+    joints_jacobians.resize(model.njoints);
+    joints_jacobians_version.assign(model.njoints, -1);
+  }
+
+  Eigen::MatrixXd& jacobian = joints_jacobians[joint];
+  if (joints_jacobians_version[joint] != kinematics_version)
+  {
+    jacobian.setZero(6, model.nv);
+    pinocchio::getJointJacobian(model, *data, joint, pinocchio::ReferenceFrame::WORLD, jacobian);
+    joints_jacobians_version[joint] = kinematics_version;
+  }
+
+  return jacobian;
+}
+
 Eigen::MatrixXd RobotWrapper::frame_jacobian(pinocchio::FrameIndex frame, pinocchio::ReferenceFrame ref)
 {
-  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> jacobian(6, model.nv);
-  jacobian.setZero();
-  pinocchio::getFrameJacobian(model, *data, frame, ref, jacobian);
+  Eigen::MatrixXd jacobian(6, model.nv);
+  frame_jacobian(frame, ref, jacobian);
 
   return jacobian;
 }
 
+void RobotWrapper::frame_jacobian(FrameIndex frame, pinocchio::ReferenceFrame ref, Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+  // The WORLD jacobian of a frame is the one of its parent joint
+  const Eigen::MatrixXd& J_world = world_joint_jacobian(model.frames[frame].parent);
+  express_jacobian(J_world, data->oMf[frame], ref, jacobian);
+}
+
 Eigen::MatrixXd RobotWrapper::frame_jacobian_time_variation(const std::string& frame, const std::string& reference)
 {
   return frame_jacobian_time_variation(get_frame_index(frame), string_to_reference(reference));
@@ -503,56 +1231,74 @@ Eigen::MatrixXd RobotWrapper::frame_jacobian_time_variation(const std::string& f
 
 Eigen::MatrixXd RobotWrapper::frame_jacobian_time_variation(pinocchio::FrameIndex frame, pinocchio::ReferenceFrame ref)
 {
-  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> jacobian(6, model.nv);
-  jacobian.setZero();
-
-  pinocchio::getFrameJacobianTimeVariation(model, *data, frame, ref, jacobian);
+  Eigen::MatrixXd jacobian(6, model.nv);
+  frame_jacobian_time_variation(frame, ref, jacobian);
 
   return jacobian;
 }
 
+void RobotWrapper::frame_jacobian_time_variation(FrameIndex frame, pinocchio::ReferenceFrame ref,
+                                                 Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+  jacobian.setZero();
+  update_jacobians_time_variation();
+  pinocchio::getFrameJacobianTimeVariation(model, *data, frame, ref, jacobian);
+}
+
 Eigen::MatrixXd RobotWrapper::joint_jacobian(const std::string& joint, const std::string& reference)
 {
-  return joint_jacobian(model.getJointId(joint), string_to_reference(reference));
+  return joint_jacobian(get_joint_index(joint), string_to_reference(reference));
 }
 
 Eigen::MatrixXd RobotWrapper::joint_jacobian(pinocchio::JointIndex joint, pinocchio::ReferenceFrame ref)
 {
-  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> jacobian(6, model.nv);
-  jacobian.setZero();
-  pinocchio::getJointJacobian(model, *data, joint, ref, jacobian);
+  Eigen::MatrixXd jacobian(6, model.nv);
+  joint_jacobian(joint, ref, jacobian);
 
   return jacobian;
 }
 
+void RobotWrapper::joint_jacobian(JointIndex joint, pinocchio::ReferenceFrame ref, Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+  const Eigen::MatrixXd& J_world = world_joint_jacobian(joint);
+  express_jacobian(J_world, data->oMi[joint], ref, jacobian);
+}
+
 Eigen::MatrixXd RobotWrapper::joint_jacobian_time_variation(const std::string& joint, const std::string& reference)
 {
-  return joint_jacobian(model.getJointId(joint), string_to_reference(reference));
+  return joint_jacobian_time_variation(get_joint_index(joint), string_to_reference(reference));
 }
 
 Eigen::MatrixXd RobotWrapper::joint_jacobian_time_variation(pinocchio::JointIndex joint, pinocchio::ReferenceFrame ref)
 {
-  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> jacobian(6, model.nv);
-  jacobian.setZero();
-  pinocchio::getJointJacobianTimeVariation(model, *data, joint, ref, jacobian);
+  Eigen::MatrixXd jacobian(6, model.nv);
+  joint_jacobian_time_variation(joint, ref, jacobian);
 
   return jacobian;
 }
 
+void RobotWrapper::joint_jacobian_time_variation(JointIndex joint, pinocchio::ReferenceFrame ref,
+                                                 Eigen::Ref<Eigen::MatrixXd> jacobian)
+{
+  jacobian.setZero();
+  update_jacobians_time_variation();
+  pinocchio::getJointJacobianTimeVariation(model, *data, joint, ref, jacobian);
+}
+
 Eigen::MatrixXd RobotWrapper::relative_position_jacobian(pinocchio::FrameIndex frame_a, pinocchio::FrameIndex frame_b)
 {
   auto T_world_a = get_T_world_frame(frame_a);
   auto T_world_b = get_T_world_frame(frame_b);
   auto T_a_b = T_world_a.inverse() * T_world_b;
 
-  Eigen::MatrixXd R_world_a = T_world_a.linear();
+  Eigen::Matrix3d R_world_a = T_world_a.linear();
 
-  Eigen::MatrixXd J_a_pos = frame_jacobian(frame_a, pinocchio::LOCAL_WORLD_ALIGNED).block(0, 0, 3, model.nv);
-  Eigen::MatrixXd J_a_rot = frame_jacobian(frame_a, pinocchio::LOCAL_WORLD_ALIGNED).block(3, 0, 3, model.nv);
-  Eigen::MatrixXd J_b_pos = frame_jacobian(frame_b, pinocchio::LOCAL_WORLD_ALIGNED).block(0, 0, 3, model.nv);
+  Eigen::MatrixXd J_a(6, model.nv), J_b(6, model.nv);
+  frame_jacobian(frame_a, pinocchio::LOCAL_WORLD_ALIGNED, J_a);
+  frame_jacobian(frame_b, pinocchio::LOCAL_WORLD_ALIGNED, J_b);
 
-  return (R_world_a.transpose() * (J_b_pos - J_a_pos) +
-          pinocchio::skew(T_a_b.translation()) * R_world_a.transpose() * J_a_rot);
+  return (R_world_a.transpose() * (J_b.topRows(3) - J_a.topRows(3)) +
+          pinocchio::skew(T_a_b.translation()) * R_world_a.transpose() * J_a.bottomRows(3));
 }
 
 Eigen::MatrixXd RobotWrapper::relative_position_jacobian(const std::string& frame_a, const std::string& frame_b)
@@ -562,22 +1308,26 @@ Eigen::MatrixXd RobotWrapper::relative_position_jacobian(const std::string& fram
 
 Eigen::Matrix3Xd RobotWrapper::com_jacobian()
 {
+  check_state();
   return pinocchio::jacobianCenterOfMass(model, *data, state.q);
 }
 
 Eigen::Matrix3Xd RobotWrapper::com_jacobian_time_variation()
 {
   // See https://github.com/stack-of-tasks/pinocchio/issues/1297
+  check_state();
   return pinocchio::computeCentroidalMapTimeVariation(model, *data, state.q, state.qd).topRows(3) / total_mass();
 }
 
 Eigen::MatrixXd RobotWrapper::centroidal_map()
 {
+  check_state();
   return pinocchio::computeCentroidalMap(model, *data, state.q);
 }
 
 Eigen::VectorXd RobotWrapper::generalized_gravity()
 {
+  check_state();
   pinocchio::computeGeneralizedGravity(model, *data, state.q);
 
   return data->g;
@@ -585,23 +1335,55 @@ Eigen::VectorXd RobotWrapper::generalized_gravity()
 
 Eigen::VectorXd RobotWrapper::non_linear_effects()
 {
+  check_state();
   return pinocchio::nonLinearEffects(model, *data, state.q, state.qd);
 }
 
+void RobotWrapper::update_mass_matrix()
+{
+  check_state();
+
+  if (!mass_matrix_updated)
+  {
+    pinocchio::crba(model, *data, state.q);
+    data->M.triangularView<Eigen::StrictlyLower>() = data->M.transpose().triangularView<Eigen::StrictlyLower>();
+    cached_mass_matrix = data->M;
+
+    // We account for inertia by adding the rotor inertia times the squared gear ratio to
+    // the diagonal (see Featherstone, Rigid Body Dynamics Algorithm, 2008, end of chapter 9.6)
+    for (int k = 0; k < cached_mass_matrix.rows(); k++)
+    {
+      cached_mass_matrix(k, k) += model.rotorGearRatio[k] * model.rotorGearRatio[k] * model.rotorInertia[k];
+    }
+
+    mass_matrix_updated = true;
+  }
+}
+
 Eigen::MatrixXd RobotWrapper::mass_matrix()
 {
-  pinocchio::crba(model, *data, state.q);
-  data->M.triangularView<Eigen::StrictlyLower>() = data->M.transpose().triangularView<Eigen::StrictlyLower>();
-  Eigen::MatrixXd M = data->M;
+  update_mass_matrix();
+
+  return cached_mass_matrix;
+}
+
+Eigen::MatrixXd RobotWrapper::mass_matrix_cholesky()
+{
+  update_mass_matrix();
 
-  // We account for inertia by adding the rotor inertia times the squared gear ratio to
-  // the diagonal (see Featherstone, Rigid Body Dynamics Algorithm, 2008, end of chapter 9.6)
-  for (int k = 0; k < M.rows(); k++)
+  if (!mass_matrix_cholesky_updated)
   {
-    M(k, k) += model.rotorGearRatio[k] * model.rotorGearRatio[k] * model.rotorInertia[k];
+    Eigen::LLT<Eigen::MatrixXd> llt(cached_mass_matrix);
+    if (llt.info() != Eigen::Success)
+    {
+      throw std::runtime_error("RobotWrapper::mass_matrix_cholesky: the mass matrix is not positive definite");
+    }
+
+    cached_mass_matrix_cholesky = llt.matrixL();
+    mass_matrix_cholesky_updated = true;
   }
 
-  return M;
+  return cached_mass_matrix_cholesky;
 }
 
 void RobotWrapper::set_gravity(Eigen::Vector3d gravity)
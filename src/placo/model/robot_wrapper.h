@@ -5,6 +5,8 @@
 #include "pinocchio/algorithm/kinematics.hpp"
 #include "pinocchio/parsers/urdf.hpp"
 #include <pinocchio/container/boost-container-limits.hpp>
+#include <memory>
+#include <unordered_map>
 
 namespace placo::model
 {
@@ -29,11 +31,33 @@ public:
     /**
      * @brief All self-collisions will be ignored (the pairs will be removed)
      */
-    IGNORE_COLLISIONS = 2
+    IGNORE_COLLISIONS = 2,
+
+    /**
+     * @brief The collision meshes are replaced with their convex hulls. Distances and collisions queries are much
+     * faster on convex shapes, at the price of a conservative approximation of the bodies.
+     */
+    CONVEX_COLLISIONS = 4,
+
+    /**
+     * @brief The check for self-collisions in the neutral position (and its warning) is skipped when loading
+     */
+    SKIP_COLLISIONS_CHECK = 8,
+
+    /**
+     * @brief The loaded models are kept in a process-wide cache, so that loading the same robot again (with this
+     * flag) copies them instead of parsing the URDF and loading the meshes again
+     */
+    MODEL_CACHE = 16
   };
 
   /**
    * @brief Creates a robot wrapper from a URDF file.
+   *
+   * With the MODEL_CACHE flag, the models (kinematics, geometries and collision pairs) are kept in a bounded
+   * process-wide cache, indexed by the directory, flags, and a hash of the URDF and collision pairs contents. A
+   * cached entry is only used if the meshes it was loaded from have the same size and modification time.
+   *
    * @param model_directory robot model (URDF). It can be a path to an URDF file, or a directory containing an URDF
    * file named 'robot.urdf'
    * @param flags see \ref Flags
@@ -42,6 +66,31 @@ public:
    */
   RobotWrapper(std::string model_directory, int flags = 0, std::string urdf_content = "");
 
+  /**
+   * @brief Creates a new context from an existing robot, without loading the URDF again.
+   *
+   * The models are copied (collision and visual geometries are shared, not duplicated), while the state is copied
+   * and a fresh pinocchio data is allocated. Different contexts can then be used concurrently from different
+   * threads.
+   *
+   * @param other robot to create the context from
+   */
+  RobotWrapper(const RobotWrapper& other);
+
+  /**
+   * @brief Clears the cache of loaded models, see \ref MODEL_CACHE
+   */
+  static void clear_model_cache();
+  RobotWrapper& operator=(const RobotWrapper& other);
+  virtual ~RobotWrapper();
+
+  /**
+   * @brief Creates contexts for the same robot (see the copy constructor), that can be used concurrently
+   * @param count number of contexts
+   * @return the contexts
+   */
+  std::vector<RobotWrapper> make_contexts(int count);
+
   /**
    * @brief Represents the robot state
    *
@@ -75,6 +124,11 @@ public:
    */
   typedef pinocchio::FrameIndex FrameIndex;
 
+  /**
+   * @brief The index of a joint (currently directly wrapped to pinocchio's JointIndex)
+   */
+  typedef pinocchio::JointIndex JointIndex;
+
   /**
    * @brief Loads collision pairs from a given JSON file.
    *
@@ -96,6 +150,27 @@ public:
    */
   void load_collision_pairs(const std::string& filename);
 
+  /**
+   * @brief Saves the current collision pairs to a JSON file, in the format used by \ref load_collision_pairs. Pairs of
+   * bodies whose collision objects pairs are all kept are written with body names, the other pairs with objects
+   * indices, so that loading the file gives back the same pairs.
+   * @param filename path to collisions.json file
+   */
+  void save_collision_pairs(const std::string& filename);
+
+  /**
+   * @brief Prunes the collision pairs by sampling random configurations. The pairs that never collide, and the
+   * ones that always collide (typically adjacent bodies), are removed.
+   *
+   * This is meant to be run offline, the pruned pairs can then be written with \ref save_collision_pairs. The
+   * floating base and the joints without limits are kept at their neutral position. The robot state is left
+   * unchanged.
+   *
+   * @param samples number of random configurations (at least 1)
+   * @return number of pairs removed
+   */
+  int prune_collision_pairs(int samples = 1000);
+
   /**
    * @brief Reset internal states, this sets q to the neutral position, qd and qdd to zero
    *
@@ -111,6 +186,14 @@ public:
    */
   FrameIndex get_frame_index(const std::string& frame);
 
+  /**
+   * @brief Retrieves a joint index from its name. This is useful to speed-up later calls to methods accepting
+   * joint indices (e.g \ref set_joint or \ref get_joint), that don't need to look up the joint name
+   * @param name joint name
+   * @return joint index
+   */
+  JointIndex get_joint_index(const std::string& name);
+
   /**
    * @brief Sets the value of a joint in state.q
    * @param name joint name
@@ -118,6 +201,13 @@ public:
    */
   void set_joint(const std::string& name, double value);
 
+  /**
+   * @brief Sets the value of a joint in state.q
+   * @param joint joint index (see \ref get_joint_index)
+   * @param value joint value (e.g rad for revolute or meters for prismatic)
+   */
+  void set_joint(JointIndex joint, double value);
+
   /**
    * @brief Retrieves a joint value from state.q
    * @param name joint name
@@ -125,6 +215,13 @@ public:
    */
   double get_joint(const std::string& name);
 
+  /**
+   * @brief Retrieves a joint value from state.q
+   * @param joint joint index (see \ref get_joint_index)
+   * @return the joint current (inner state) value (e.g rad for revolute or meters for prismatic)
+   */
+  double get_joint(JointIndex joint);
+
   /**
    * @brief Sets the joint velocity in state.qd
    * @param name joint name
@@ -160,6 +257,14 @@ public:
    */
   int get_joint_offset(const std::string& name);
 
+  /**
+   * @brief Gets the offset for a given joint in the \ref state (in \ref State.q), raises an error if the index is
+   * not the one of an actuated joint
+   * @param joint joint index (see \ref get_joint_index)
+   * @return offset in state.q
+   */
+  int get_joint_offset(JointIndex joint);
+
   /**
    * @brief Gets the offset for a given joint in the \ref state (in \ref State.qd and \ref State.qdd)
    * @param name joint name
@@ -167,6 +272,14 @@ public:
    */
   int get_joint_v_offset(const std::string& name);
 
+  /**
+   * @brief Gets the offset for a given joint in the \ref state (in \ref State.qd and \ref State.qdd), raises an
+   * error if the index is not the one of an actuated joint
+   * @param joint joint index (see \ref get_joint_index)
+   * @return offset in state.qd and state.qdd
+   */
+  int get_joint_v_offset(JointIndex joint);
+
   /**
    * @brief Sets the limits for a given joint.
    *
@@ -221,6 +334,10 @@ public:
   /**
    * @brief Update internal computation for kinematics (frames, jacobian). This method should be called when
    * the robot state has changed.
+   *
+   * The kinematics quantities (frames placements, jacobians, jacobians time variation, CoM and mass matrix) are
+   * computed lazily when they are queried, and cached until \ref state changes. This method only checks if the
+   * state changed since the last computation.
    */
   void update_kinematics();
 
@@ -414,9 +531,19 @@ public:
    * This can be used for collision avoidance (e.g in \ref kinematics::KinematicsSolver and \ref
    * dynamics::DynamicsSolver)
    *
+   * The pairs whose bounding spheres are further than ``max_distance`` are skipped (they are not part of the
+   * result). The nearest points of the previous call are used to warm start the distance computation of each pair.
+   *
+   * @param max_distance only the pairs that can be closer than this distance are computed
    * @return vector of \ref Distance
    */
-  std::vector<Distance> distances();
+  std::vector<Distance> distances(double max_distance = std::numeric_limits<double>::infinity());
+
+  /**
+   * @brief If true, \ref self_collisions and \ref distances evaluate the collision pairs in parallel, using the
+   * shared thread pool. The results are the same (and in the same order) as the sequential evaluation.
+   */
+  bool parallel_collisions = false;
 
   /**
    * @brief Frame jacobian, default reference is LOCAL_WORLD_ALIGNED
@@ -439,6 +566,18 @@ public:
    */
   Eigen::MatrixXd frame_jacobian(const std::string& frame, const std::string& reference = "local_world_aligned");
 
+  /**
+   * @brief Frame jacobian, written in a caller-provided (6 x nv) buffer
+   *
+   * The jacobians of the joints are cached for the current configuration, so that frames attached to the same joint
+   * or requested in different references share the same computation.
+   *
+   * @param frame the frame for which we want the jacobian
+   * @param ref the reference frame
+   * @param jacobian output buffer
+   */
+  void frame_jacobian(FrameIndex frame, pinocchio::ReferenceFrame ref, Eigen::Ref<Eigen::MatrixXd> jacobian);
+
   /**
    * @brief Jacobian time variation \f$\dot J\f$, default reference is LOCAL_WORLD_ALIGNED
    *
@@ -463,6 +602,15 @@ public:
   Eigen::MatrixXd frame_jacobian_time_variation(const std::string& frame, const std::string& reference = "local_world_"
                                                                                                          "aligned");
 
+  /**
+   * @brief Jacobian time variation \f$\dot J\f$, written in a caller-provided (6 x nv) buffer
+   * @param frame the frame for which we want the jacobian time variation
+   * @param ref the reference frame
+   * @param jacobian output buffer
+   */
+  void frame_jacobian_time_variation(FrameIndex frame, pinocchio::ReferenceFrame ref,
+                                     Eigen::Ref<Eigen::MatrixXd> jacobian);
+
   /**
    * @brief Joint jacobian, default reference is LOCAL_WORLD_ALIGNED
    *
@@ -476,6 +624,14 @@ public:
 
   Eigen::MatrixXd joint_jacobian(const std::string& joint, const std::string& reference = "local_world_aligned");
 
+  /**
+   * @brief Joint jacobian, written in a caller-provided (6 x nv) buffer
+   * @param joint the joint for which we want the jacobian
+   * @param ref the reference frame
+   * @param jacobian output buffer
+   */
+  void joint_jacobian(JointIndex joint, pinocchio::ReferenceFrame ref, Eigen::Ref<Eigen::MatrixXd> jacobian);
+
   /**
    * @brief Joint jacobian time variation \f$\dot J\f$, default reference is LOCAL_WORLD_ALIGNED
    *
@@ -501,6 +657,15 @@ public:
   Eigen::MatrixXd joint_jacobian_time_variation(const std::string& joint, const std::string& reference = "local_world_"
                                                                                                          "aligned");
 
+  /**
+   * @brief Joint jacobian time variation \f$\dot J\f$, written in a caller-provided (6 x nv) buffer
+   * @param joint the joint for which we want the jacobian time variation
+   * @param ref the reference frame
+   * @param jacobian output buffer
+   */
+  void joint_jacobian_time_variation(JointIndex joint, pinocchio::ReferenceFrame ref,
+                                     Eigen::Ref<Eigen::MatrixXd> jacobian);
+
   /**
    * @brief Jacobian of the relative position of the position of b expressed in a
    *
@@ -565,6 +730,13 @@ public:
    */
   Eigen::MatrixXd mass_matrix();
 
+  /**
+   * @brief Computes the (lower triangular) Cholesky factor L of the mass matrix, such that \f$M = L L^T\f$
+   *
+   * It is cached along with the mass matrix until the state changes.
+   */
+  Eigen::MatrixXd mass_matrix_cholesky();
+
   /**
    * @brief Sets the gravity vector
    */
@@ -656,7 +828,8 @@ public:
   pinocchio::GeometryModel visual_model;
 
   /**
-   * @brief Pinocchio model data
+   * @brief Pinocchio model data, owned by this context. All the methods of the robot (even the queries) are
+   * using it as a workspace, a context should thus not be used from multiple threads at once.
    */
   pinocchio::Data* data;
 
@@ -665,5 +838,157 @@ protected:
    * @brief Free flyer joint
    */
   pinocchio::JointModelFreeFlyer root_joint;
+
+  /**
+   * @brief Joints and frames indices by name, built when the model is loaded
+   */
+  std::unordered_map<std::string, JointIndex> joints_indices;
+  std::unordered_map<std::string, FrameIndex> frames_indices;
+
+  /**
+   * @brief Parses the URDF and loads the model, the geometries and the collision pairs
+   */
+  void load_models(const std::string& model_directory, const std::string& urdf_filename, int flags,
+                   const std::string& urdf_content);
+
+  /**
+   * @brief Builds the joints and frames names look-up tables
+   */
+  void build_names_tables();
+
+  /**
+   * @brief Throws if the given index is not the one of an actuated joint (the universe and root joints are rejected)
+   */
+  void check_joint_index(JointIndex joint);
+
+  /**
+   * @brief Configuration and velocity for which the cached kinematics quantities are computed
+   */
+  Eigen::VectorXd kinematics_q;
+  Eigen::VectorXd kinematics_qd;
+
+  /**
+   * @brief Quantities that are up-to-date in data for the current state
+   */
+  bool placements_updated = false;
+  bool jacobians_updated = false;
+  bool jacobians_time_variation_updated = false;
+  bool com_updated = false;
+  bool mass_matrix_updated = false;
+  bool mass_matrix_cholesky_updated = false;
+
+  /**
+   * @brief Collision data, kept from one call to another (created when needed)
+   */
+  pinocchio::GeometryData* collision_data = nullptr;
+
+  /**
+   * @brief Bounding sphere of a collision object, expressed in its geometry frame
+   */
+  struct BoundingSphere
+  {
+    Eigen::Vector3d center;
+    double radius;
+  };
+
+  /**
+   * @brief Bounding spheres of the collision objects, used as a broad phase for collisions and distances
+   */
+  std::vector<BoundingSphere> collision_spheres;
+
+  /**
+   * @brief Computes the collision objects bounding spheres
+   */
+  void compute_collision_spheres();
+
+  /**
+   * @brief Clears the collision data (main and workers ones), this should be called whenever the collision pairs
+   * change, since the data holds per-pair requests, results and guesses
+   */
+  void clear_collision_data();
+
+  /**
+   * @brief Ensures that the collision data exists and that the geometry placements are up-to-date
+   */
+  void update_collision_data();
+
+  /**
+   * @brief Lower bound of the distance between the objects of a collision pair, based on their bounding spheres
+   */
+  double bounding_spheres_distance(const pinocchio::CollisionPair& pair);
+
+  /**
+   * @brief Collision data for each worker of the thread pool, used when \ref parallel_collisions is enabled
+   */
+  std::vector<std::unique_ptr<pinocchio::GeometryData>> workers_collision_data;
+
+  /**
+   * @brief Ensures that there is one collision data per worker, with up-to-date geometry placements
+   */
+  void update_workers_collision_data(int workers);
+
+  /**
+   * @brief Checks a collision pair using the given collision data
+   * @return true if the objects are colliding (collision is then filled)
+   */
+  bool compute_collision(pinocchio::GeometryData& geometry_data, int pair, Collision& collision);
+
+  /**
+   * @brief Computes the distance of a collision pair using the given collision data
+   * @return false if the pair was skipped by the broad phase (distance is otherwise filled)
+   */
+  bool compute_distance(pinocchio::GeometryData& geometry_data, int pair, double max_distance, Distance& distance);
+
+  /**
+   * @brief Cached mass matrix (including rotors inertia)
+   */
+  Eigen::MatrixXd cached_mass_matrix;
+
+  /**
+   * @brief Cached Cholesky factor of the mass matrix
+   */
+  Eigen::MatrixXd cached_mass_matrix_cholesky;
+
+  /**
+   * @brief Incremented each time the configuration changes, used to check the validity of cached quantities
+   */
+  int kinematics_version = 0;
+
+  /**
+   * @brief Cached joints jacobians (in the WORLD frame), and the kinematics version they were computed for
+   */
+  std::vector<Eigen::MatrixXd> joints_jacobians;
+  std::vector<int> joints_jacobians_version;
+
+  /**
+   * @brief Joint jacobian in the WORLD frame, computed once per configuration
+   */
+  const Eigen::MatrixXd& world_joint_jacobian(JointIndex joint);
+
+  /**
+   * @brief Ensures that the mass matrix is up-to-date
+   */
+  void update_mass_matrix();
+
+  /**
+   * @brief Invalidates the cached quantities if the state changed since they were computed. This should be called
+   * before any computation using data.
+   */
+  void check_state();
+
+  /**
+   * @brief Ensures that the frames placements are up-to-date
+   */
+  void update_placements();
+
+  /**
+   * @brief Ensures that the joints jacobians (and the frames placements) are up-to-date
+   */
+  void update_jacobians();
+
+  /**
+   * @brief Ensures that the joints jacobians time variation (and the jacobians and frames placements) are up-to-date
+   */
+  void update_jacobians_time_variation();
 };
 }  // namespace placo::model
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include <cmath>
+#include <limits>
+#include "placo/problem/admm_solver.h"
+
+namespace placo::problem
+{
+bool ADMMSolver::factorize(const SparseMatrix& P, const SparseMatrix& C, const Eigen::VectorXd& rho_vector)
+{
+  SparseMatrix identity(P.rows(), P.cols());
+  identity.setIdentity();
+
+  SparseMatrix RC = rho_vector.asDiagonal() * C;
+  SparseMatrix K = SparseMatrix(C.transpose()) * RC;
+  K += P;
+  K += sigma * identity;
+
+  ldlt.compute(K);
+
+  return ldlt.info() == Eigen::Success;
+}
+
+// Infinity norms of the columns of M
+static Eigen::VectorXd columns_norms(const ADMMSolver::SparseMatrix& M)
+{
+  Eigen::VectorXd norms = Eigen::VectorXd::Zero(M.cols());
+  for (int column = 0; column < M.outerSize(); column++)
+  {
+    for (ADMMSolver::SparseMatrix::InnerIterator it(M, column); it; ++it)
+    {
+      norms(column) = std::max(norms(column), fabs(it.value()));
+    }
+  }
+
+  return norms;
+}
+
+// Infinity norms of the rows of M
+static Eigen::VectorXd rows_norms(const ADMMSolver::SparseMatrix& M)
+{
+  Eigen::VectorXd norms = Eigen::VectorXd::Zero(M.rows());
+  for (int column = 0; column < M.outerSize(); column++)
+  {
+    for (ADMMSolver::SparseMatrix::InnerIterator it(M, column); it; ++it)
+    {
+      norms(it.row()) = std::max(norms(it.row()), fabs(it.value()));
+    }
+  }
+
+  return norms;
+}
+
+// Inverse square root of the norms, used for equilibration (null norms are left unscaled)
+static Eigen::VectorXd equilibration(const Eigen::VectorXd& norms)
+{
+  Eigen::VectorXd scaling(norms.rows());
+  for (int k = 0; k < norms.rows(); k++)
+  {
+    scaling(k) = norms(k) < 1e-4 ? 1. : 1. / sqrt(norms(k));
+  }
+
+  return scaling;
+}
+
+bool ADMMSolver::solve(const SparseMatrix& P_, const Eigen::VectorXd& q_, const SparseMatrix& C_,
+                       const Eigen::VectorXd& l_, const Eigen::VectorXd& u_)
+{
+  int n = P_.cols();
+  int m = C_.rows();
+  iterations = 0;
+
+  // Ruiz equilibration: the solver works on x = D x_s, with constraints E C D x_s and cost c (D P D, D q)
+  SparseMatrix P = P_;
+  SparseMatrix C = C_;
+  Eigen::VectorXd q = q_;
+  Eigen::VectorXd D = Eigen::VectorXd::Ones(n);
+  Eigen::VectorXd E = Eigen::VectorXd::Ones(m);
+
+  for (int k = 0; k < scaling_iterations; k++)
+  {
+    Eigen::VectorXd d = equilibration(columns_norms(P).cwiseMax(columns_norms(C)));
+    Eigen::VectorXd e = equilibration(rows_norms(C));
+
+    P = d.asDiagonal() * P * d.asDiagonal();
+    C = e.asDiagonal() * C * d.asDiagonal();
+    q = d.cwiseProduct(q);
+    D = D.cwiseProduct(d);
+    E = E.cwiseProduct(e);
+  }
+
+  double cost_scale = 1.;
+  if (scaling_iterations > 0 && n > 0)
+  {
+    double cost_norm = std::max(columns_norms(P).mean(), q.lpNorm<Eigen::Infinity>());
+    cost_scale = cost_norm < 1e-4 ? 1. : std::min(1. / cost_norm, 1e4);
+    P *= cost_scale;
+    q *= cost_scale;
+  }
+
+  Eigen::VectorXd l = E.cwiseProduct(l_);
+  Eigen::VectorXd u = E.cwiseProduct(u_);
+
+  if (!warm_start || x.rows() != n || z.rows() != m)
+  {
+    x.setZero(n);
+    z.setZero(m);
+    y.setZero(m);
+  }
+
+  // Scaling the initial guess
+  x = x.cwiseQuotient(D);
+  z = z.cwiseProduct(E);
+  y = cost_scale * y.cwiseQuotient(E);
+
+  // Equality constraints use a larger step size, and unbounded rows a very small one
+  Eigen::VectorXd rho_scale(m);
+  for (int k = 0; k < m; k++)
+  {
+    if (l(k) == u(k))
+    {
+      rho_scale(k) = 1e3;
+    }
+    else if (std::isinf(l(k)) && std::isinf(u(k)))
+    {
+      rho_scale(k) = 1e-6 / rho;
+    }
+    else
+    {
+      rho_scale(k) = 1.;
+    }
+  }
+
+  double current_rho = rho;
+  Eigen::VectorXd rho_vector = current_rho * rho_scale;
+  bool converged = false;
+
+  if (!factorize(P, C, rho_vector))
+  {
+    return false;
+  }
+
+  SparseMatrix Ct = C.transpose();
+  Eigen::VectorXd x_tilde(n), z_tilde(m), z_relaxed(m), Cx(m), Px(n), Cty(n);
+  Eigen::VectorXd D_inv = D.cwiseInverse();
+  Eigen::VectorXd E_inv = E.cwiseInverse();
+  double q_norm = D_inv.cwiseProduct(q).lpNorm<Eigen::Infinity>() / cost_scale;
+
+  for (iterations = 1; iterations <= max_iterations; iterations++)
+  {
+    // Solving the reduced KKT system
+    x_tilde = ldlt.solve(sigma * x - q + Ct * (rho_vector.cwiseProduct(z) - y));
+    z_tilde.noalias() = C * x_tilde;
+
+    // Relaxation, projection on the bounds and dual update
+    x = alpha * x_tilde + (1. - alpha) * x;
+    z_relaxed = alpha * z_tilde + (1. - alpha) * z;
+    z = (z_relaxed + y.cwiseQuotient(rho_vector)).cwiseMax(l).cwiseMin(u);
+    y += rho_vector.cwiseProduct(z_relaxed - z);
+
+    // Checking convergence on the unscaled residuals
+    Cx.noalias() = C * x;
+    Px.noalias() = P * x;
+    Cty.noalias() = Ct * y;
+
+    double primal_scale = std::max(E_inv.cwiseProduct(Cx).lpNorm<Eigen::Infinity>(),
+                                   E_inv.cwiseProduct(z).lpNorm<Eigen::Infinity>());
+    double dual_scale = std::max(std::max(D_inv.cwiseProduct(Px).lpNorm<Eigen::Infinity>(),
+                                          D_inv.cwiseProduct(Cty).lpNorm<Eigen::Infinity>()) /
+                                     cost_scale,
+                                 q_norm);
+
+    primal_residual = m > 0 ? E_inv.cwiseProduct(Cx - z).lpNorm<Eigen::Infinity>() : 0.;
+    dual_residual = D_inv.cwiseProduct(Px + q + Cty).lpNorm<Eigen::Infinity>() / cost_scale;
+
+    if (primal_residual <= eps_abs + eps_rel * primal_scale && dual_residual <= eps_abs + eps_rel * dual_scale)
+    {
+      converged = true;
+      break;
+    }
+
+    // Adapting the step size to balance the primal and dual residuals
+    if (m > 0 && iterations % adaptive_rho_interval == 0)
+    {
+      // Using the scaled residuals, since the iterations are performed on the scaled problem
+      double scaled_primal = (Cx - z).lpNorm<Eigen::Infinity>() /
+                             (std::max(Cx.lpNorm<Eigen::Infinity>(), z.lpNorm<Eigen::Infinity>()) + 1e-10);
+      double scaled_dual = (Px + q + Cty).lpNorm<Eigen::Infinity>() /
+                           (std::max(std::max(Px.lpNorm<Eigen::Infinity>(), Cty.lpNorm<Eigen::Infinity>()),
+                                     q.lpNorm<Eigen::Infinity>()) +
+                            1e-10);
+      double ratio = std::sqrt(scaled_primal / (scaled_dual + 1e-10));
+      double new_rho = std::min(std::max(current_rho * ratio, 1e-6), 1e6);
+
+      if (new_rho > 5. * current_rho || new_rho < 0.2 * current_rho)
+      {
+        current_rho = new_rho;
+        rho_vector = current_rho * rho_scale;
+
+        if (!factorize(P, C, rho_vector))
+        {
+          return false;
+        }
+      }
+    }
+  }
+
+  iterations = std::min(iterations, max_iterations);
+
+  // Unscaling the solution
+  x = D.cwiseProduct(x);
+  z = E_inv.cwiseProduct(z);
+  y = E.cwiseProduct(y) / cost_scale;
+
+  return converged;
+}
+}  // namespace placo::problem
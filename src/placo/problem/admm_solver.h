@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+namespace placo::problem
+{
+/**
+ * @brief Sparse QP solver based on the alternating direction method of multipliers (ADMM), following the
+ * operator splitting used by OSQP.
+ *
+ * Solves \f$\min \frac{1}{2} x^T P x + q^T x\f$ subject to \f$l \leq C x \leq u\f$, where P and C are sparse.
+ * Equality constraints are expressed with \f$l = u\f$, and bounds can be infinite. Each iteration only requires a
+ * solve with the sparse LDL^T factorization of \f$P + \sigma I + C^T R C\f$, which is computed once per solve
+ * (and again when the step size \f$\rho\f$ is adapted).
+ */
+class ADMMSolver
+{
+public:
+  typedef Eigen::SparseMatrix<double> SparseMatrix;
+
+  /**
+   * @brief Solves the QP
+   * @param P sparse (symmetric) hessian
+   * @param q linear cost
+   * @param C sparse constraints matrix
+   * @param l lower bounds (can be -infinity)
+   * @param u upper bounds (can be infinity)
+   * @return true if the solver converged to the required tolerances
+   */
+  bool solve(const SparseMatrix& P, const Eigen::VectorXd& q, const SparseMatrix& C, const Eigen::VectorXd& l,
+             const Eigen::VectorXd& u);
+
+  /**
+   * @brief Primal solution
+   */
+  Eigen::VectorXd x;
+
+  /**
+   * @brief Constraints values Cx, projected on the bounds
+   */
+  Eigen::VectorXd z;
+
+  /**
+   * @brief Dual solution (negative values for active lower bounds, positive for active upper bounds)
+   */
+  Eigen::VectorXd y;
+
+  /**
+   * @brief Initial ADMM step size
+   */
+  double rho = 0.1;
+
+  /**
+   * @brief Regularization added to the primal variables
+   */
+  double sigma = 1e-6;
+
+  /**
+   * @brief Relaxation parameter (between 0 and 2)
+   */
+  double alpha = 1.6;
+
+  /**
+   * @brief Absolute tolerance on the primal and dual residuals
+   */
+  double eps_abs = 1e-6;
+
+  /**
+   * @brief Relative tolerance on the primal and dual residuals
+   */
+  double eps_rel = 1e-6;
+
+  /**
+   * @brief Maximum number of ADMM iterations
+   */
+  int max_iterations = 4000;
+
+  /**
+   * @brief The step size is adapted (and the KKT matrix factorized again) at most every this number of iterations
+   */
+  int adaptive_rho_interval = 25;
+
+  /**
+   * @brief Number of Ruiz equilibration iterations used to scale the problem data (0 to disable)
+   */
+  int scaling_iterations = 10;
+
+  /**
+   * @brief If true, the previous solution (x, z and y) is used as initial guess if the problem size didn't change
+   */
+  bool warm_start = false;
+
+  /**
+   * @brief Number of iterations performed by the last solve
+   */
+  int iterations = 0;
+
+  /**
+   * @brief Residuals obtained at the end of the last solve
+   */
+  double primal_residual = 0.;
+  double dual_residual = 0.;
+
+protected:
+  /**
+   * @brief Factorization of the KKT (reduced) matrix
+   */
+  Eigen::SimplicialLDLT<SparseMatrix> ldlt;
+
+  /**
+   * @brief Factorizes P + sigma I + C^T diag(rho_vector) C
+   * @return true if the factorization succeeded
+   */
+  bool factorize(const SparseMatrix& P, const SparseMatrix& C, const Eigen::VectorXd& rho_vector);
+};
+}  // namespace placo::problem
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <vector>
 #include <Eigen/Dense>
 #include "placo/problem/expression.h"
+#include "placo/problem/sparsity.h"
 
 namespace placo::problem
 {
@@ -63,11 +65,37 @@ public:
    */
   double weight = 1.0;
 
+  /**
+   * @brief Priority level of soft constraints when the problem is solved hierarchically (lower levels are more
+   * important), see \ref Problem::hierarchical
+   */
+  int level = 0;
+
+  /**
+   * @brief Columns of the expression that can be non-zero, if known in advance by the constraint builder. If it is
+   * empty, the sparsity is detected by scanning the expression (see \ref Problem::use_sparsity)
+   */
+  Sparsity sparsity;
+
   /**
    * @brief This flag will be set by the solver if the constraint is active in the optimal solution
    */
   bool is_active = false;
 
+  /**
+   * @brief Rows of the expression that are active in the optimal solution (in increasing order), set by the solver.
+   * All the rows of equality constraints are active
+   */
+  std::vector<int> active_rows;
+
+  /**
+   * @brief Lagrange multipliers of the expression rows, set by the solver. They are such that the gradient of the
+   * objective is \f$\sum A^T \lambda\f$ over the hard constraints, and are positive for active inequalities (zero
+   * for inactive ones). For soft constraints, this is the penalty gradient \f$-w (Ax + b - s)\f$ (s being the slack
+   * variables of soft inequalities), i.e. the multiplier the constraint would have if it was hard
+   */
+  Eigen::VectorXd duals;
+
   /**
    * @brief Configures the constraint
    * @param priority_ priority
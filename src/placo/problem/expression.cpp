@@ -10,6 +10,12 @@ Expression::Expression()
 {
 }
 
+void Expression::allocate(int rows, int cols)
+{
+  A.setZero(rows, cols);
+  b.setZero(rows);
+}
+
 Expression Expression::from_vector(const Eigen::VectorXd& v)
 {
   return Expression(v);
@@ -18,17 +24,18 @@ Expression Expression::from_vector(const Eigen::VectorXd& v)
 Expression Expression::from_double(const double& value)
 {
   Expression e;
-  e.A = Eigen::MatrixXd(1, 0);
-  e.b = Eigen::VectorXd(1);
+  e.allocate(1, 0);
   e.b(0, 0) = value;
 
   return e;
 }
 
-Expression::Expression(const Expression& other)
+Expression::Expression(const Expression& other) : A(other.A), b(other.b)
+{
+}
+
+Expression::Expression(Expression&& other) noexcept : A(std::move(other.A)), b(std::move(other.b))
 {
-  A = other.A;
-  b = other.b;
 }
 
 Expression::Expression(const Eigen::VectorXd& v)
@@ -37,6 +44,22 @@ Expression::Expression(const Eigen::VectorXd& v)
   b = v;
 }
 
+Expression& Expression::operator=(const Expression& other)
+{
+  A = other.A;
+  b = other.b;
+
+  return *this;
+}
+
+Expression& Expression::operator=(Expression&& other) noexcept
+{
+  A = std::move(other.A);
+  b = std::move(other.b);
+
+  return *this;
+}
+
 bool Expression::is_scalar() const
 {
   return rows() == 1;
@@ -76,13 +99,61 @@ Expression Expression::piecewise_add(double f) const
 {
   // Assuming a scalar piece-wise sum
   Expression e(*this);
+  e.b.array() += f;
+
+  return e;
+}
 
-  for (int k = 0; k < e.b.rows(); k++)
+static void check_same_rows(const Expression& e1, const Expression& e2)
+{
+  if (e1.rows() != e2.rows())
   {
-    e.b(k, 0) += f;
+    std::ostringstream oss;
+    oss << "Trying to add expressions with different # of rows (" << e1.rows() << " vs " << e2.rows() << ")";
+    throw std::runtime_error(oss.str());
   }
+}
 
-  return e;
+Expression& Expression::operator+=(const Expression& other)
+{
+  check_same_rows(*this, other);
+
+  if (other.cols() > cols())
+  {
+    int previous_cols = cols();
+    A.conservativeResize(Eigen::NoChange, other.cols());
+    A.rightCols(other.cols() - previous_cols).setZero();
+  }
+
+  A.leftCols(other.cols()) += other.A;
+  b += other.b;
+
+  return *this;
+}
+
+Expression& Expression::operator-=(const Expression& other)
+{
+  check_same_rows(*this, other);
+
+  if (other.cols() > cols())
+  {
+    int previous_cols = cols();
+    A.conservativeResize(Eigen::NoChange, other.cols());
+    A.rightCols(other.cols() - previous_cols).setZero();
+  }
+
+  A.leftCols(other.cols()) -= other.A;
+  b -= other.b;
+
+  return *this;
+}
+
+Expression& Expression::operator*=(double f)
+{
+  A *= f;
+  b *= f;
+
+  return *this;
 }
 
 Expression Expression::operator+(const Expression& other) const
@@ -96,36 +167,46 @@ Expression Expression::operator+(const Expression& other) const
     return piecewise_add(other.b(0, 0));
   }
 
-  if (rows() != other.rows())
+  check_same_rows(*this, other);
+
+  // Copying the widest expression to avoid resizing it
+  if (cols() >= other.cols())
   {
-    std::ostringstream oss;
-    oss << "Trying to add expressions with different # of rows (" << rows() << " vs " << other.rows() << ")";
-    throw std::runtime_error(oss.str());
+    Expression e(*this);
+    e += other;
+    return e;
+  }
+  else
+  {
+    Expression e(other);
+    e += *this;
+    return e;
   }
-
-  Expression e;
-
-  e.A = Eigen::MatrixXd(rows(), std::max(cols(), other.cols()));
-  e.A.setZero();
-  e.b = Eigen::VectorXd(rows());
-  e.b.setZero();
-
-  e.A.block(0, 0, rows(), cols()) = A.block(0, 0, rows(), cols());
-  e.A.block(0, 0, rows(), other.cols()) += other.A.block(0, 0, rows(), other.cols());
-  e.b = b;
-  e.b += other.b;
-
-  return e;
 }
 
 Expression Expression::operator-(const Expression& other) const
 {
-  return (*this) + (other * (-1.));
+  if (is_scalar() && is_constant())
+  {
+    return (-other).piecewise_add(b(0, 0));
+  }
+  else if (other.is_scalar() && other.is_constant())
+  {
+    return piecewise_add(-other.b(0, 0));
+  }
+
+  Expression e(*this);
+  e -= other;
+
+  return e;
 }
 
 Expression Expression::operator-() const
 {
-  return (*this) * (-1.);
+  Expression e(*this);
+  e *= -1.;
+
+  return e;
 }
 
 Expression operator*(double f, const Expression& e)
@@ -136,8 +217,7 @@ Expression operator*(double f, const Expression& e)
 Expression Expression::operator*(double f) const
 {
   Expression e(*this);
-  e.A *= f;
-  e.b *= f;
+  e *= f;
 
   return e;
 }
@@ -147,8 +227,7 @@ Expression Expression::operator*(const Expression& other) const
   if (is_scalar() && other.is_constant())
   {
     Expression e;
-    e.A.resize(other.rows(), cols());
-    e.b.resize(other.rows());
+    e.allocate(other.rows(), cols());
     for (int k = 0; k < other.rows(); k++)
     {
       e.A.row(k) = A.row(0) * other.b(k);
@@ -221,9 +300,11 @@ Expression operator-(double f, const Expression& e)
 
 Expression operator*(const Eigen::MatrixXd M, const Expression& e_)
 {
-  Expression e(e_);
-  e.A = M.operator*(e.A);
-  e.b = M.operator*(e.b);
+  Expression e;
+  e.A.resize(M.rows(), e_.A.cols());
+  e.b.resize(M.rows());
+  e.A.noalias() = M.operator*(e_.A);
+  e.b.noalias() = M.operator*(e_.b);
 
   return e;
 }
@@ -236,16 +317,10 @@ Expression Expression::left_multiply(const Eigen::MatrixXd M)
 Expression Expression::sum()
 {
   Expression e;
-  e.A = Eigen::MatrixXd(1, cols());
-  e.A.setZero();
-  e.b = Eigen::VectorXd(1);
-  e.b.setZero();
+  e.allocate(1, cols());
 
-  for (int k = 0; k < rows(); k++)
-  {
-    e.A.block(0, 0, 1, cols()) += A.block(k, 0, 1, cols());
-    e.b.block(0, 0, 1, 1) += b.block(k, 0, 1, 1);
-  }
+  e.A = A.colwise().sum();
+  e.b(0) = b.sum();
 
   return e;
 }
@@ -262,11 +337,7 @@ Expression Expression::mean()
 Expression Expression::operator/(const Expression& other) const
 {
   Expression e;
-
-  e.A = Eigen::MatrixXd(rows() + other.rows(), std::max(cols(), other.cols()));
-  e.A.setZero();
-  e.b = Eigen::VectorXd(rows() + other.rows());
-  e.b.setZero();
+  e.allocate(rows() + other.rows(), std::max(cols(), other.cols()));
 
   e.A.block(0, 0, rows(), cols()) = A;
   e.A.block(rows(), 0, other.rows(), other.cols()) = other.A;
@@ -291,7 +362,7 @@ ProblemConstraint Expression::operator<=(const Expression& other) const
 {
   ProblemConstraint constraint;
 
-  constraint.expression = -(*this - other);
+  constraint.expression = other - *this;
   constraint.type = ProblemConstraint::Inequality;
 
   return constraint;
@@ -2,6 +2,7 @@
 
 #include <Eigen/Dense>
 #include "placo/problem/sparsity.h"
+#include "placo/problem/expression_pool.h"
 
 namespace placo::problem
 {
@@ -16,17 +17,28 @@ class Expression
 public:
   Expression();
   Expression(const Expression& other);
+  Expression(Expression&& other) noexcept;
   Expression(const Eigen::VectorXd& v);
 
+  Expression& operator=(const Expression& other);
+  Expression& operator=(Expression&& other) noexcept;
+
+  /**
+   * @brief Allocates A and b for the given shape, with zero values
+   * @param rows number of rows
+   * @param cols number of cols
+   */
+  void allocate(int rows, int cols);
+
   /**
    * @brief Expression A matrix, in Ax + b
    */
-  Eigen::MatrixXd A = Eigen::MatrixXd(0, 0);
+  PooledMatrix<Eigen::MatrixXd> A;
 
   /**
    * @brief Expression b vector, in Ax + b
    */
-  Eigen::VectorXd b = Eigen::VectorXd(0);
+  PooledMatrix<Eigen::VectorXd> b;
 
   /**
    * @brief Slice rows from a given expression
@@ -115,6 +127,11 @@ public:
    */
   Expression mean();
 
+  // In-place operations (expressions should have the same number of rows)
+  Expression& operator+=(const Expression& other);
+  Expression& operator-=(const Expression& other);
+  Expression& operator*=(double f);
+
   // Summing expressions
   Expression operator+(const Expression& other) const;
   Expression operator-(const Expression& other) const;
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include "placo/problem/expression_pool.h"
+
+namespace placo::problem
+{
+thread_local size_t ExpressionPool::heap_allocations = 0;
+thread_local ExpressionPool* ExpressionPool::current_pool = nullptr;
+
+ExpressionPool::ExpressionPool()
+{
+}
+
+ExpressionPool::ExpressionPool(const ExpressionPool& other)
+{
+}
+
+ExpressionPool& ExpressionPool::operator=(const ExpressionPool& other)
+{
+  return *this;
+}
+
+double* ExpressionPool::allocate(size_t size)
+{
+  if (chunks.size() == 0 || chunk_used + size > chunks_sizes.back())
+  {
+    // Chunks sizes are doubled, so that the number of chunks stays logarithmic in the total size
+    size_t chunk_size = std::max<size_t>(size, chunks.size() == 0 ? 1024 : 2 * chunks_sizes.back());
+    previous_chunks_used += chunk_used;
+    chunks.push_back(std::unique_ptr<double[]>(new double[chunk_size]));
+    chunks_sizes.push_back(chunk_size);
+    chunk_used = 0;
+  }
+
+  double* data = chunks.back().get() + chunk_used;
+  chunk_used += size;
+
+  return data;
+}
+
+void ExpressionPool::reset()
+{
+  if (chunks.size() > 1)
+  {
+    // Merging the chunks, so that the next uses fit in a single one
+    size_t total_size = 0;
+    for (size_t size : chunks_sizes)
+    {
+      total_size += size;
+    }
+
+    chunks.clear();
+    chunks_sizes.clear();
+    chunks.push_back(std::unique_ptr<double[]>(new double[total_size]));
+    chunks_sizes.push_back(total_size);
+  }
+
+  chunk_used = 0;
+  previous_chunks_used = 0;
+}
+
+size_t ExpressionPool::allocated() const
+{
+  return previous_chunks_used + chunk_used;
+}
+
+ExpressionPool::Scope::Scope(ExpressionPool& pool) : previous(current_pool)
+{
+  current_pool = &pool;
+}
+
+ExpressionPool::Scope::~Scope()
+{
+  current_pool = previous;
+}
+
+ExpressionPool* ExpressionPool::current()
+{
+  return current_pool;
+}
+}  // namespace placo::problem
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace placo::problem
+{
+/**
+ * @brief Monotonic memory pool for the buffers of \ref Expression.
+ *
+ * While a \ref Scope on a pool is alive, the expressions created or resized in the calling thread take their buffers
+ * from this pool instead of the heap. Allocating from the pool only moves an offset in a pre-allocated chunk, and
+ * all the buffers are released in one shot by \ref reset, which keeps the memory for the next uses. Since each
+ * \ref Problem owns its pool, problems built concurrently don't contend on the heap allocator.
+ *
+ * The expressions allocated from a pool should not be used after it is reset or destroyed.
+ */
+class ExpressionPool
+{
+public:
+  ExpressionPool();
+
+  /**
+   * @brief Copying a pool creates an empty pool (the buffers are never shared)
+   */
+  ExpressionPool(const ExpressionPool& other);
+  ExpressionPool& operator=(const ExpressionPool& other);
+
+  /**
+   * @brief Allocates a buffer of the given number of doubles (uninitialized)
+   * @param size number of doubles
+   * @return pointer to the buffer
+   */
+  double* allocate(size_t size);
+
+  /**
+   * @brief Releases all the buffers allocated from the pool. The memory is kept (in a single chunk) for the next uses
+   */
+  void reset();
+
+  /**
+   * @brief Number of doubles currently allocated from the pool
+   */
+  size_t allocated() const;
+
+  /**
+   * @brief While it is alive, the expressions created in the current thread are allocated from the given pool.
+   * Scopes can be nested, the previous pool is restored when the scope is destroyed
+   */
+  class Scope
+  {
+  public:
+    Scope(ExpressionPool& pool);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  protected:
+    ExpressionPool* previous;
+  };
+
+  /**
+   * @brief Pool of the innermost \ref Scope alive in the current thread (nullptr if there is none)
+   */
+  static ExpressionPool* current();
+
+  /**
+   * @brief Number of expression buffers allocated on the heap (outside of any pool) so far in the current thread.
+   * It is never reset, see \ref Problem::expression_allocations for a per-problem count
+   */
+  static thread_local size_t heap_allocations;
+
+protected:
+  static thread_local ExpressionPool* current_pool;
+
+  /**
+   * @brief Memory chunks, buffers are allocated at the end of the last one
+   */
+  std::vector<std::unique_ptr<double[]>> chunks;
+  std::vector<size_t> chunks_sizes;
+
+  /**
+   * @brief Number of doubles used in the last chunk, and in the previous ones
+   */
+  size_t chunk_used = 0;
+  size_t previous_chunks_used = 0;
+};
+
+/**
+ * @brief Storage of the \ref Expression matrices: a map over a buffer that is either taken from the current
+ * \ref ExpressionPool or owned (heap allocated).
+ *
+ * It can be used as an Eigen matrix (T is Eigen::MatrixXd or Eigen::VectorXd), assigning it an expression of another
+ * shape, resizing it or copying it allocates a new buffer.
+ */
+template <typename T>
+class PooledMatrix : public Eigen::Map<T>
+{
+public:
+  typedef Eigen::Map<T> Base;
+  using Base::setZero;
+
+  PooledMatrix() : Base(nullptr, 0, empty_cols)
+  {
+  }
+
+  PooledMatrix(const PooledMatrix& other) : Base(nullptr, 0, empty_cols)
+  {
+    assign(other);
+  }
+
+  PooledMatrix(PooledMatrix&& other) noexcept : Base(other.data(), other.rows(), other.cols()), owned(std::move(other.owned))
+  {
+    other.reseat(nullptr, 0, empty_cols);
+  }
+
+  PooledMatrix& operator=(const PooledMatrix& other)
+  {
+    if (this != &other)
+    {
+      assign(other);
+    }
+
+    return *this;
+  }
+
+  PooledMatrix& operator=(PooledMatrix&& other) noexcept
+  {
+    if (this != &other)
+    {
+      owned = std::move(other.owned);
+      reseat(other.data(), other.rows(), other.cols());
+      other.reseat(nullptr, 0, empty_cols);
+    }
+
+    return *this;
+  }
+
+  template <typename OtherDerived>
+  PooledMatrix& operator=(const Eigen::DenseBase<OtherDerived>& other)
+  {
+    assign(other.derived());
+    return *this;
+  }
+
+  /**
+   * @brief Resizes the matrix, its values are not initialized (the buffer is kept if its size doesn't change)
+   */
+  void resize(Eigen::Index rows, Eigen::Index cols)
+  {
+    if (rows * cols == this->size())
+    {
+      reseat(this->data(), rows, cols);
+    }
+    else
+    {
+      reseat(allocate(rows * cols), rows, cols);
+    }
+  }
+
+  void resize(Eigen::Index size)
+  {
+    resize(size, empty_cols == 1 ? 1 : 0);
+  }
+
+  /**
+   * @brief Resizes the matrix, keeping the values of its top left corner (other values are not initialized)
+   */
+  void conservativeResize(Eigen::Index rows, Eigen::Index cols)
+  {
+    if (rows == this->rows() && cols == this->cols())
+    {
+      return;
+    }
+
+    // The previous buffer is kept alive while its values are copied
+    std::unique_ptr<double[]> previous = std::move(owned);
+    Base previous_map(this->data(), this->rows(), this->cols());
+
+    reseat(allocate(rows * cols), rows, cols);
+    Eigen::Index common_rows = std::min(rows, previous_map.rows());
+    Eigen::Index common_cols = std::min(cols, previous_map.cols());
+    this->topLeftCorner(common_rows, common_cols) = previous_map.topLeftCorner(common_rows, common_cols);
+  }
+
+  void conservativeResize(Eigen::NoChange_t, Eigen::Index cols)
+  {
+    conservativeResize(this->rows(), cols);
+  }
+
+  void setZero(Eigen::Index rows, Eigen::Index cols)
+  {
+    resize(rows, cols);
+    Base::setZero();
+  }
+
+  void setZero(Eigen::Index size)
+  {
+    resize(size);
+    Base::setZero();
+  }
+
+  /**
+   * @brief true if the buffer was taken from an \ref ExpressionPool
+   */
+  bool pooled() const
+  {
+    return this->data() != nullptr && owned == nullptr;
+  }
+
+protected:
+  // Number of columns of an empty matrix (vectors always have one column)
+  static constexpr int empty_cols = T::ColsAtCompileTime == 1 ? 1 : 0;
+
+  /**
+   * @brief Owned buffer, if it was not taken from a pool
+   */
+  std::unique_ptr<double[]> owned;
+
+  /**
+   * @brief Allocates a new buffer (from the current pool if any), the previous owned one is released
+   */
+  double* allocate(Eigen::Index size)
+  {
+    owned.reset();
+
+    if (size == 0)
+    {
+      return nullptr;
+    }
+
+    ExpressionPool* pool = ExpressionPool::current();
+    if (pool != nullptr)
+    {
+      return pool->allocate(size);
+    }
+
+    ExpressionPool::heap_allocations += 1;
+    owned.reset(new double[size]);
+    return owned.get();
+  }
+
+  /**
+   * @brief Changes the buffer and shape of the map
+   */
+  void reseat(double* data, Eigen::Index rows, Eigen::Index cols)
+  {
+    new (static_cast<Base*>(this)) Base(data, rows, cols);
+  }
+
+  template <typename OtherDerived>
+  void assign(const OtherDerived& other)
+  {
+    if (other.rows() == this->rows() && other.cols() == this->cols())
+    {
+      Base::operator=(other);
+    }
+    else
+    {
+      // The previous buffer is kept alive while other is evaluated, since it can depend on it. The new buffer can't
+      // alias other
+      std::unique_ptr<double[]> previous = std::move(owned);
+      reseat(allocate(other.rows() * other.cols()), other.rows(), other.cols());
+      Base::noalias() = other;
+    }
+  }
+};
+}  // namespace placo::problem
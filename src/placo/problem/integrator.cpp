@@ -58,6 +58,18 @@ Integrator::Integrator(Variable& variable_, Expression X0, Eigen::MatrixXd syste
   A = AB.first;
   B = AB.second;
 
+  // Registering the dynamics in the variable, so that the problem can be solved in stage-wise form
+  if (X0.is_constant())
+  {
+    variable->integrator_A = A;
+    variable->integrator_B = B;
+    variable->integrator_X0 = X0.b;
+  }
+  else
+  {
+    variable->integrator_A.resize(0, 0);
+  }
+
   // Computing final transition matrix and powers of A
   final_transition_matrix = Eigen::MatrixXd(order, N);
   final_transition_matrix.setZero();
@@ -142,20 +154,17 @@ Expression Integrator::expr(int step, int diff)
   {
     Expression e;
     int rows = (diff == -1) ? order : 1;
-    e.A = Eigen::MatrixXd(rows, variable->k_end);
-    e.A.setZero();
-    e.b = Eigen::VectorXd(rows);
-    e.b.setZero();
+    e.allocate(rows, variable->k_end);
 
     if (diff == -1)
     {
       e.A.block(0, variable->k_start, rows, step) = final_transition_matrix.block(0, N - step, rows, step);
-      e = e + a_powers[step] * X0;
+      e += a_powers[step] * X0;
     }
     else
     {
       e.A.block(0, variable->k_start, 1, step) = final_transition_matrix.block(diff, N - step, 1, step);
-      e = e + (a_powers[step] * X0).slice(diff, 1);
+      e += Eigen::MatrixXd(a_powers[step].row(diff)) * X0;
     }
 
     return e;
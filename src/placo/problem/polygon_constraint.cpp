@@ -12,8 +12,7 @@ problem::ProblemConstraint PolygonConstraint::in_polygon_xy(const Expression& ex
   }
 
   problem::Expression values;
-  values.A.resize(polygon.size(), expression_xy.cols());
-  values.b.resize(polygon.size());
+  values.allocate(polygon.size(), expression_xy.cols());
 
   for (size_t i = 0; i < polygon.size(); i++)
   {
@@ -29,9 +28,8 @@ problem::ProblemConstraint PolygonConstraint::in_polygon_xy(const Expression& ex
     n.normalize();
 
     // The distance to the line is given by n.T * (P - A) >= margin
-    problem::Expression value = (n.transpose() * (expression_xy - A)) - margin;
-    values.A.block(i, 0, 1, expression_xy.cols()) = value.A;
-    values.b(i) = value.b(0);
+    values.A.row(i).noalias() = n.transpose() * expression_xy.A;
+    values.b(i) = n.dot(expression_xy.b - A) - margin;
   }
 
   return values >= 0;
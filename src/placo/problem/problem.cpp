@@ -1,4 +1,4 @@
-#include <map>
+#include <algorithm>
 #include <chrono>
 #include "placo/problem/problem.h"
 #include "placo/problem/qp_error.h"
@@ -12,7 +12,7 @@ Problem::Problem()
 
 Problem::~Problem()
 {
-  for (auto constraint : constraints)
+  for (auto constraint : constraints_memory)
   {
     delete constraint;
   }
@@ -22,6 +22,7 @@ Problem::~Problem()
     delete variable;
   }
 
+  constraints_memory.clear();
   constraints.clear();
   variables.clear();
 }
@@ -44,8 +45,7 @@ ProblemConstraint& Problem::add_limit(Expression expression, Eigen::VectorXd tar
   // -target <= expression <= target
   Eigen::VectorXd targets(target.rows() * 2);
   problem::Expression e;
-  e.A.resize(expression.A.rows() * 2, expression.A.cols());
-  e.b.resize(expression.b.rows() * 2, expression.b.cols());
+  e.allocate(expression.A.rows() * 2, expression.A.cols());
 
   // Ax + b <= target
   e.A.block(0, 0, expression.A.rows(), expression.A.cols()) = expression.A;
@@ -63,7 +63,19 @@ ProblemConstraint& Problem::add_limit(Expression expression, Eigen::VectorXd tar
 
 ProblemConstraint& Problem::add_constraint(const ProblemConstraint& constraint_)
 {
-  ProblemConstraint* constraint = new ProblemConstraint;
+  ProblemConstraint* constraint;
+
+  if (constraints.size() < constraints_memory.size())
+  {
+    // Recycling a constraint object that was kept by clear_constraints()
+    constraint = constraints_memory[constraints.size()];
+  }
+  else
+  {
+    constraint = new ProblemConstraint;
+    constraints_memory.push_back(constraint);
+  }
+
   *constraint = constraint_;
   constraints.push_back(constraint);
 
@@ -72,76 +84,83 @@ ProblemConstraint& Problem::add_constraint(const ProblemConstraint& constraint_)
 
 void Problem::clear_constraints()
 {
-  for (auto constraint : constraints)
+  if (!reuse_structure)
   {
-    delete constraint;
+    for (auto constraint : constraints_memory)
+    {
+      delete constraint;
+    }
+
+    constraints_memory.clear();
+  }
+  else
+  {
+    // Recycled constraints can't keep buffers from the pool, since they will be reused by new expressions
+    for (auto constraint : constraints_memory)
+    {
+      if (constraint->expression.A.pooled() || constraint->expression.b.pooled())
+      {
+        constraint->expression = Expression();
+      }
+    }
   }
 
   constraints.clear();
+  expression_pool.reset();
+  allocations_start = ExpressionPool::heap_allocations;
 }
 
-void Problem::clear_variables()
+int Problem::constraints_count() const
 {
-  for (auto variable : variables)
-  {
-    delete variable;
-  }
-
-  variables.clear();
-  n_variables = 0;
+  return constraints.size();
 }
 
-void Problem::get_constraint_expressions(ProblemConstraint* constraint, Eigen::MatrixXd& A, Eigen::MatrixXd& b)
+Eigen::VectorXd Problem::constraints_duals(int start, int end) const
 {
-  if (determined_variables)
+  int rows = 0;
+  for (int k = start; k < end; k++)
   {
-    Eigen::MatrixXd full_A(constraint->expression.A.rows(), n_variables);
-    full_A.setZero();
-    full_A.block(0, 0, constraint->expression.A.rows(), constraint->expression.A.cols()) = constraint->expression.A;
-    QR.matrixQ().applyThisOnTheRight(full_A);
-
-    A = full_A.rightCols(free_variables);
-    b = constraint->expression.b + full_A.leftCols(determined_variables) * y;
+    rows += constraints[k]->duals.rows();
   }
-  else
+
+  Eigen::VectorXd duals(rows);
+  rows = 0;
+  for (int k = start; k < end; k++)
   {
-    A = constraint->expression.A;
-    b = constraint->expression.b;
+    duals.segment(rows, constraints[k]->duals.rows()) = constraints[k]->duals;
+    rows += constraints[k]->duals.rows();
   }
+
+  return duals;
 }
 
-void Problem::solve()
+void Problem::set_constraints_level(int start, int end, int level)
 {
-  n_equalities = 0;
-  n_inequalities = 0;
-  slack_variables = 0;
+  for (int k = start; k < end; k++)
+  {
+    constraints[k]->level = level;
+  }
+}
 
-  for (auto constraint : constraints)
+void Problem::clear_variables()
+{
+  for (auto variable : variables)
   {
-    if (constraint->type == ProblemConstraint::Inequality)
-    {
-      constraint->is_active = false;
-      if (constraint->priority == ProblemConstraint::Soft)
-      {
-        slack_variables += constraint->expression.rows();
-      }
-    }
-    else
-    {
-      if (constraint->priority == ProblemConstraint::Hard)
-      {
-        n_equalities += constraint->expression.rows();
-      }
-      constraint->is_active = true;
-    }
+    delete variable;
   }
 
-  // Equality constraints
-  Eigen::MatrixXd A(n_equalities, n_variables);
-  Eigen::VectorXd b(n_equalities);
+  variables.clear();
+  n_variables = 0;
+}
+
+void Problem::build_equalities(Eigen::MatrixXd& A, Eigen::VectorXd& b)
+{
+  A.resize(n_equalities, n_variables);
+  b.resize(n_equalities);
   A.setZero();
   b.setZero();
   int k_equality = 0;
+  equalities_mapping.assign(n_equalities, RowMapping());
 
   for (auto constraint : constraints)
   {
@@ -150,247 +169,1660 @@ void Problem::solve()
       // Ax + b = 0
       A.block(k_equality, 0, constraint->expression.rows(), constraint->expression.cols()) = constraint->expression.A;
       b.block(k_equality, 0, constraint->expression.rows(), 1) = constraint->expression.b;
+      for (int k = 0; k < constraint->expression.rows(); k++)
+      {
+        equalities_mapping[k_equality + k] = { constraint, k };
+      }
       k_equality += constraint->expression.rows();
     }
   }
+}
 
-  free_variables = n_variables;
-  determined_variables = 0;
+void Problem::compute_equalities_nullspace(const Eigen::MatrixXd& A, const Eigen::VectorXd& b)
+{
+  // Computing QR decomposition of A.T, unless the equality matrix is the same as the one of a previous solve (in
+  // that case, only the right-hand side changed)
+  qr_reused = (A.rows() == QR_equalities.rows() && A.cols() == QR_equalities.cols() && A == QR_equalities);
 
-  if (rewrite_equalities && A.rows() > 0)
+  if (!qr_reused)
   {
-    // Computing QR decomposition of A.T
     QR = A.transpose().colPivHouseholderQr();
 
-    determined_variables = QR.rank();
-
-    if (determined_variables != A.rows())
+    if (QR.rank() != A.rows())
     {
+      QR_equalities.resize(0, 0);
       throw QPError("QR decomposition failed to find a full rank matrix for equality constraints");
     }
 
-    Eigen::MatrixXd R = QR.matrixR().transpose().block(0, 0, determined_variables, determined_variables);
-    Eigen::MatrixXd b2 = b.transpose();
-    QR.colsPermutation().applyThisOnTheRight(b2);
-    b2.transposeInPlace();
-
-    y = R.triangularView<Eigen::Lower>().solve(-b2);
-
-    free_variables = n_variables - determined_variables;
-
-    // Removing equality constraints
-    n_equalities = 0.;
-    A.resize(0, 0);
-    b.resize(0);
+    Q = QR.householderQ();
+    QR_equalities = A;
   }
 
-  Eigen::MatrixXd P(free_variables + slack_variables, free_variables + slack_variables);
-  Eigen::VectorXd q(free_variables + slack_variables);
+  determined_variables = QR.rank();
 
-  P.setZero();
-  q.setZero();
+  Eigen::MatrixXd R = QR.matrixR().transpose().block(0, 0, determined_variables, determined_variables);
+  Eigen::MatrixXd b2 = b.transpose();
+  QR.colsPermutation().applyThisOnTheRight(b2);
+  b2.transposeInPlace();
 
-  // Adding regularization
-  P.block(0, 0, free_variables, free_variables).setIdentity();
-  P.block(0, 0, free_variables, free_variables) *= regularization;
+  y = R.triangularView<Eigen::Lower>().solve(-b2);
+  x_determined.noalias() = Q.leftCols(determined_variables) * y;
 
-  // Scanning the constraints (counting inequalities and equalities, building objectif function)
-  for (auto constraint : constraints)
+  free_variables = n_variables - determined_variables;
+
+  if (!qr_reused || (int)nullspace_sparsity.size() != n_variables)
   {
-    if (constraint->expression.cols() > n_variables)
-    {
-      throw QPError("Problem: Inconsistent problem size");
-    }
-    if (constraint->expression.A.rows() == 0 || constraint->expression.b.rows() == 0)
-    {
-      throw QPError("Problem: A or b is empty");
-    }
-    if (constraint->expression.A.rows() != constraint->expression.b.rows())
+    nullspace_sparsity.resize(n_variables);
+    for (int row = 0; row < n_variables; row++)
     {
-      throw QPError("Problem: A.rows() != b.rows()");
+      nullspace_sparsity[row] = Sparsity::detect_columns_sparsity(Q.rightCols(free_variables).row(row));
     }
+  }
+}
 
-    if (constraint->type == ProblemConstraint::Inequality)
+void Problem::project_constraints()
+{
+  // Stacking the constraints (padded to n_variables columns), that are then projected with a single product
+  int rows = 0;
+  projected_offsets.assign(constraints.size(), -1);
+
+  for (size_t k = 0; k < constraints.size(); k++)
+  {
+    ProblemConstraint* constraint = constraints[k];
+    if (constraint->type == ProblemConstraint::Inequality || constraint->priority == ProblemConstraint::Soft)
     {
-      // If the constraint is hard, this will be the true inequality, else, this will be the inequality
-      // enforcing the slack variable to be >= 0
-      n_inequalities += constraint->expression.rows();
+      projected_offsets[k] = rows;
+      rows += constraint->expression.rows();
     }
-    else if (constraint->priority == ProblemConstraint::Soft)
-    {
-      Eigen::MatrixXd expression_A;
-      Eigen::MatrixXd expression_b;
-      get_constraint_expressions(constraint, expression_A, expression_b);
-
-      // Adding the soft constraint to the objective function
-      if (use_sparsity)
-      {
-        Sparsity sparsity = Sparsity::detect_columns_sparsity(expression_A);
-
-        int constraints = expression_A.rows();
-
-        for (auto interval : sparsity.intervals)
-        {
-          int size = 1 + interval.end - interval.start;
-
-          Eigen::MatrixXd block = expression_A.block(0, interval.start, constraints, size);
+  }
 
-          P.block(interval.start, interval.start, size, size).noalias() +=
-              constraint->weight * block.transpose() * block;
-        }
+  Eigen::MatrixXd stacked_A(rows, n_variables);
+  projected_b.resize(rows);
+  stacked_A.setZero();
 
-        q.block(0, 0, expression_A.cols(), 1).noalias() +=
-            constraint->weight * (expression_A.transpose() * expression_b);
-      }
-      else
+  for (size_t k = 0; k < constraints.size(); k++)
+  {
+    if (projected_offsets[k] >= 0)
+    {
+      const Expression& expression = constraints[k]->expression;
+      if (expression.cols() > n_variables)
       {
-        int n = expression_A.cols();
-        P.block(0, 0, n, n).noalias() += constraint->weight * (expression_A.transpose() * expression_A);
-        q.block(0, 0, n, 1).noalias() += constraint->weight * (expression_A.transpose() * expression_b);
+        throw QPError("Problem: Inconsistent problem size");
       }
+      stacked_A.block(projected_offsets[k], 0, expression.rows(), expression.cols()) = expression.A;
+      projected_b.segment(projected_offsets[k], expression.rows()) = expression.b;
     }
   }
 
-  // Inequality constraints
-  Eigen::MatrixXd G(n_inequalities, free_variables + slack_variables);
-  Eigen::VectorXd h(n_inequalities);
-  G.setZero();
-  h.setZero();
-
-  // Used to keep track of the hard/soft inequalities constraints
-  // The hard mapping maps index from inequality row to constraint, and the soft
-  // mapping maps index from slack variables to the constraint.
-  std::map<int, ProblemConstraint*> hard_inequalities_mapping;
-  std::map<int, ProblemConstraint*> soft_inequalities_mapping;
+  // With x = Q [y, u], we have Ax + b = (A Q_free) u + (A Q y + b)
+  projected_A.resize(rows, free_variables);
+  projected_A.noalias() = stacked_A * Q.rightCols(free_variables);
+  projected_b.noalias() += stacked_A * x_determined;
+}
 
-  int k_inequality = 0;
-  int k_slack = 0;
+void Problem::get_constraint_expressions(int index, Eigen::MatrixXd& A, Eigen::MatrixXd& b)
+{
+  const Expression& expression = constraints[index]->expression;
 
-  // Slack variables should be positive
-  for (int slack = 0; slack < slack_variables; slack += 1)
+  if (determined_variables)
   {
-    // s_i >= 0
-    G(k_inequality, free_variables + slack) = 1;
-    k_inequality += 1;
+    A = projected_A.middleRows(projected_offsets[index], expression.rows());
+    b = projected_b.segment(projected_offsets[index], expression.rows());
   }
+  else
+  {
+    A = expression.A;
+    b = expression.b;
+  }
+}
 
+void Problem::reset_activity()
+{
   for (auto constraint : constraints)
   {
-    if (constraint->type == ProblemConstraint::Inequality)
-    {
-      Eigen::MatrixXd expression_A;
-      Eigen::MatrixXd expression_b;
-      get_constraint_expressions(constraint, expression_A, expression_b);
+    constraint->active_rows.clear();
+    constraint->duals.setZero(constraint->expression.rows());
+    constraint->is_active = (constraint->type == ProblemConstraint::Equality);
 
-      if (constraint->priority == ProblemConstraint::Hard)
+    if (constraint->is_active)
+    {
+      for (int row = 0; row < constraint->expression.rows(); row++)
       {
-        // Ax + b >= 0
-        G.block(k_inequality, 0, expression_A.rows(), expression_A.cols()) = expression_A;
-        h.block(k_inequality, 0, expression_b.rows(), 1) = expression_b;
-
-        for (int k = k_inequality; k < k_inequality + expression_A.rows(); k++)
-        {
-          hard_inequalities_mapping[k] = constraint;
-        }
-        k_inequality += expression_A.rows();
+        constraint->active_rows.push_back(row);
       }
-      else
-      {
-        // min(Ax + b - s)
-        // A slack variable is assigend with all "soft" inequality and a minimization is added to the problem
-        Eigen::MatrixXd As(expression_A.rows(), free_variables + slack_variables);
-        As.setZero();
-        As.block(0, 0, expression_A.rows(), expression_A.cols()) = expression_A;
+    }
+  }
+}
 
-        for (int k = 0; k < expression_A.rows(); k++)
-        {
-          soft_inequalities_mapping[k_slack] = constraint;
-          As(k, free_variables + k_slack) = -1;
-          k_slack += 1;
-        }
+void Problem::set_active(const RowMapping& mapping)
+{
+  if (mapping.constraint != nullptr)
+  {
+    mapping.constraint->is_active = true;
+    mapping.constraint->active_rows.push_back(mapping.row);
+  }
+}
 
-        P.noalias() += constraint->weight * (As.transpose() * As);
-        q.noalias() += constraint->weight * (As.transpose() * expression_b);
-      }
+void Problem::set_dual(const RowMapping& mapping, double dual)
+{
+  if (mapping.constraint != nullptr)
+  {
+    mapping.constraint->duals(mapping.row) = dual;
+  }
+}
+
+void Problem::compute_soft_duals()
+{
+  for (auto constraint : constraints)
+  {
+    if (constraint->priority == ProblemConstraint::Soft)
+    {
+      const Expression& expression = constraint->expression;
+      constraint->duals.noalias() = -constraint->weight * (expression.A * x.head(expression.cols()));
+      constraint->duals -= constraint->weight * expression.b;
     }
   }
 
-  Eigen::VectorXi active_set;
-  size_t active_set_size;
+  for (int k = 0; k < slacks.rows(); k++)
+  {
+    const RowMapping& mapping = slacks_mapping[k];
+    mapping.constraint->duals(mapping.row) += mapping.constraint->weight * slacks(k);
+  }
+}
 
-  Eigen::VectorXd qp_x(free_variables + slack_variables);
-  qp_x.setZero();
-  double result =
-      eiquadprog::solvers::solve_quadprog(P, q, A.transpose(), b, G.transpose(), h, qp_x, active_set, active_set_size);
+bool Problem::solve_warm_start(const Eigen::MatrixXd& P, const Eigen::VectorXd& q, const Eigen::MatrixXd& A,
+                               const Eigen::VectorXd& b, const Eigen::MatrixXd& G, const Eigen::VectorXd& h,
+                               Eigen::VectorXd& x, Eigen::VectorXd& duals, Eigen::VectorXi& active_set,
+                               size_t& active_set_size)
+{
+  const double epsilon = 1e-8;
 
-  if (determined_variables)
+  // The previous active set can only be used if the problem has the same shape
+  if (previous_shape != Eigen::Vector3i(P.rows(), A.rows(), G.rows()))
   {
-    Eigen::VectorXd u(n_variables, 1);
-    u.setZero();
-    u.topRows(determined_variables) = y;
-    u.bottomRows(free_variables) = qp_x.topRows(free_variables);
-    QR.matrixQ().applyThisOnTheLeft(u);
-    x = u;
+    return false;
   }
-  else
+
+  Eigen::LLT<Eigen::MatrixXd> llt(P);
+  if (llt.info() != Eigen::Success)
   {
-    x = qp_x;
+    return false;
   }
+  Eigen::VectorXd P_inv_q = llt.solve(q);
 
-  // Checking that the problem is indeed feasible
-  if (result == std::numeric_limits<double>::infinity())
+  // Inequalities that are assumed to be active (working set)
+  std::vector<int> working_set = previous_active_set;
+  std::vector<bool> in_working_set(G.rows(), false);
+  for (int k : working_set)
   {
-    throw QPError("Problem: Infeasible QP (check your hard inequality constraints)");
+    in_working_set[k] = true;
   }
 
-  // Checking that equality constraints were enforced, since this is not covered by above result
-  if (A.rows() > 0)
+  for (warm_start_iterations = 1; warm_start_iterations <= warm_start_max_iterations; warm_start_iterations++)
   {
-    Eigen::VectorXd equality_constraints = A * x.topRows(A.cols()) + b;
-    for (int k = 0; k < A.rows(); k++)
+    // Building the constraints Cx + d = 0 (equalities and working set)
+    int n_constraints = A.rows() + working_set.size();
+    Eigen::MatrixXd C(n_constraints, P.rows());
+    Eigen::VectorXd d(n_constraints);
+    if (A.rows() > 0)
     {
-      if (fabs(equality_constraints[k]) > 1e-6)
+      C.topRows(A.rows()) = A;
+      d.head(A.rows()) = b;
+    }
+    for (int k = 0; k < working_set.size(); k++)
+    {
+      C.row(A.rows() + k) = G.row(working_set[k]);
+      d(A.rows() + k) = h(working_set[k]);
+    }
+
+    // Solving the KKT conditions, where multipliers lambda are such that Px + q = C^T lambda
+    Eigen::VectorXd lambda(n_constraints);
+    if (n_constraints > 0)
+    {
+      Eigen::MatrixXd P_inv_Ct = llt.solve(C.transpose());
+      Eigen::ColPivHouseholderQR<Eigen::MatrixXd> schur(C * P_inv_Ct);
+      if (schur.rank() < n_constraints)
       {
-        throw QPError("Problem: Infeasible QP (equality constraints were not enforced)");
+        // Working set constraints are degenerate
+        return false;
       }
+      lambda = schur.solve(C * P_inv_q - d);
+      x = P_inv_Ct * lambda - P_inv_q;
+    }
+    else
+    {
+      x = -P_inv_q;
     }
-  }
 
-  // Checking for NaNs in solution
-  if (x.hasNaN())
-  {
-    throw QPError("Problem: NaN in the QP solution");
-  }
+    // Checking primal feasibility, the most violated inequality is added to the working set
+    int most_violated = -1;
+    double min_value = -epsilon;
+    for (int k = 0; k < G.rows(); k++)
+    {
+      if (!in_working_set[k])
+      {
+        double value = G.row(k).dot(x) + h(k);
+        if (value < min_value)
+        {
+          most_violated = k;
+          min_value = value;
+        }
+      }
+    }
+    if (most_violated >= 0)
+    {
+      working_set.push_back(most_violated);
+      in_working_set[most_violated] = true;
+      continue;
+    }
 
-  // Reporting on the active constraints
-  for (int k = 0; k < active_set_size; k++)
-  {
-    int active_constraint = active_set[k];
+    // Checking dual feasibility, the inequality with the most negative multiplier is removed from the working set
+    int most_negative = -1;
+    double min_lambda = -epsilon;
+    for (int k = 0; k < working_set.size(); k++)
+    {
+      if (lambda(A.rows() + k) < min_lambda)
+      {
+        most_negative = k;
+        min_lambda = lambda(A.rows() + k);
+      }
+    }
+    if (most_negative >= 0)
+    {
+      in_working_set[working_set[most_negative]] = false;
+      working_set.erase(working_set.begin() + most_negative);
+      continue;
+    }
 
-    if (active_constraint >= 0 && hard_inequalities_mapping.count(active_constraint))
+    // KKT conditions are met, the solution is optimal. Active set follows eiquadprog conventions: equality
+    // constraints are numbered -1, -2, ..., and inequalities by their index
+    active_set_size = n_constraints;
+    active_set.resize(n_constraints);
+    duals = lambda;
+    for (int k = 0; k < A.rows(); k++)
+    {
+      active_set[k] = -k - 1;
+    }
+    for (int k = 0; k < working_set.size(); k++)
     {
-      hard_inequalities_mapping[active_constraint]->is_active = true;
+      active_set[A.rows() + k] = working_set[k];
     }
+
+    return true;
   }
 
-  slacks = qp_x.block(free_variables, 0, slack_variables, 1);
-  for (int k = 0; k < slacks.rows(); k++)
+  warm_start_iterations = warm_start_max_iterations;
+  return false;
+}
+
+// Columns sparsity of A Q_free, given the columns sparsity of A and the columns sparsity of each row of Q_free: a
+// column of the product is non-zero only if a row of Q_free in the columns of A has a non-zero entry in it
+static Sparsity projected_sparsity(const Sparsity& sparsity, const std::vector<Sparsity>& rows_sparsity, int columns)
+{
+  // Number of intervals covering each column, as differences between consecutive columns
+  std::vector<int> coverage(columns + 1, 0);
+  for (auto& interval : sparsity.intervals)
   {
-    if (slacks[k] <= 1e-6 && soft_inequalities_mapping.count(k))
+    for (int row = interval.start; row <= std::min<int>(interval.end, rows_sparsity.size() - 1); row++)
     {
-      soft_inequalities_mapping[k]->is_active = true;
+      for (auto& row_interval : rows_sparsity[row].intervals)
+      {
+        coverage[row_interval.start] += 1;
+        coverage[row_interval.end + 1] -= 1;
+      }
     }
   }
 
-  for (auto variable : variables)
+  Sparsity result;
+  int count = 0;
+  int start = -1;
+  for (int column = 0; column < columns; column++)
   {
-    variable->version += 1;
-    variable->value = Eigen::VectorXd(variable->size());
-    variable->value = x.block(variable->k_start, 0, variable->size(), 1);
+    count += coverage[column];
+    if (count > 0 && start == -1)
+    {
+      start = column;
+    }
+    else if (count == 0 && start != -1)
+    {
+      result.add_interval(start, column - 1);
+      start = -1;
+    }
   }
+  if (start != -1)
+  {
+    result.add_interval(start, columns - 1);
+  }
+
+  return result;
 }
 
-void Problem::dump_status()
+// Calls f(start_i, size_i, start_j, size_j) for all the blocks of A^T A given by the columns sparsity of A
+template <typename F>
+static void for_each_hessian_block(const Sparsity& sparsity, int cols, F f)
+{
+  for (auto& interval_i : sparsity.intervals)
+  {
+    int start_i = interval_i.start;
+    int size_i = 1 + std::min<int>(interval_i.end, cols - 1) - start_i;
+    if (size_i <= 0)
+    {
+      continue;
+    }
+
+    for (auto& interval_j : sparsity.intervals)
+    {
+      int start_j = interval_j.start;
+      int size_j = 1 + std::min<int>(interval_j.end, cols - 1) - start_j;
+      if (size_j <= 0)
+      {
+        continue;
+      }
+
+      f(start_i, size_i, start_j, size_j);
+    }
+  }
+}
+
+bool Problem::solve_direct(const Eigen::MatrixXd& P, const Eigen::VectorXd& q, const Eigen::MatrixXd& A,
+                           const Eigen::VectorXd& b, Eigen::VectorXd& x, Eigen::VectorXd& duals,
+                           Eigen::VectorXi& active_set, size_t& active_set_size)
+{
+  // Cholesky factorization of P, computed again only if P changed
+  factorization_reused =
+      (direct_P.rows() > 0 && P.rows() == direct_P.rows() && P.cols() == direct_P.cols() && P == direct_P);
+  if (!factorization_reused)
+  {
+    // When a single soft constraint weight changed, P changes by (delta weight) A^T A, which is applied to the
+    // factorization as rank one updates (one per row of A) if A has few rows
+    bool updated = false;
+    if (rank_update_constraint >= 0 && P.rows() == direct_P.rows() && rank_updates < max_rank_updates)
+    {
+      const Eigen::MatrixXd& A_updated = soft_contributions[rank_update_constraint].A;
+      if (3 * A_updated.rows() < P.rows())
+      {
+        Eigen::VectorXd v = Eigen::VectorXd::Zero(P.rows());
+        for (int row = 0; row < A_updated.rows(); row++)
+        {
+          v.head(A_updated.cols()) = sqrt(fabs(rank_update_weight)) * A_updated.row(row).transpose();
+          direct_llt.rankUpdate(v, rank_update_weight > 0 ? 1. : -1.);
+        }
+        updated = (direct_llt.info() == Eigen::Success);
+      }
+    }
+
+    if (updated)
+    {
+      rank_updates += 1;
+    }
+    else
+    {
+      // The factorization is computed from scratch, which also bounds the numerical errors accumulated by updates
+      direct_llt.compute(P);
+      rank_updates = 0;
+    }
+    if (direct_llt.info() != Eigen::Success)
+    {
+      direct_P.resize(0, 0);
+      return false;
+    }
+    direct_P = P;
+    direct_A.resize(0, 0);
+  }
+
+  Eigen::VectorXd P_inv_q = direct_llt.solve(q);
+
+  if (A.rows() > 0)
+  {
+    // Solving the KKT conditions with the Schur complement A P^-1 A^T, where multipliers lambda are such that
+    // Px + q = A^T lambda
+    if (!(A.rows() == direct_A.rows() && A.cols() == direct_A.cols() && A == direct_A))
+    {
+      factorization_reused = false;
+      direct_P_inv_At = direct_llt.solve(A.transpose());
+      direct_schur.compute(A * direct_P_inv_At);
+      if (direct_schur.rank() < A.rows())
+      {
+        // Equality constraints are degenerate
+        direct_A.resize(0, 0);
+        return false;
+      }
+      direct_A = A;
+    }
+
+    duals = direct_schur.solve(A * P_inv_q - b);
+    x = direct_P_inv_At * duals - P_inv_q;
+  }
+  else
+  {
+    x = -P_inv_q;
+    duals.resize(0);
+  }
+
+  // Equality constraints are numbered -1, -2, ... in the active set, following eiquadprog conventions
+  active_set_size = A.rows();
+  active_set.resize(A.rows());
+  for (int k = 0; k < A.rows(); k++)
+  {
+    active_set[k] = -k - 1;
+  }
+
+  return true;
+}
+
+void Problem::solve()
+{
+  auto start = std::chrono::steady_clock::now();
+
+  expression_allocations = ExpressionPool::heap_allocations - allocations_start;
+
+  if (hierarchical)
+  {
+    solve_hierarchical();
+    solve_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return;
+  }
+
+  if (qp_solver == ADMM)
+  {
+    solve_admm();
+    solve_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return;
+  }
+
+  if (qp_solver == Riccati)
+  {
+    riccati_fallback = !solve_riccati();
+    if (!riccati_fallback)
+    {
+      solve_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      return;
+    }
+  }
+
+  n_equalities = 0;
+  n_inequalities = 0;
+  slack_variables = 0;
+
+  // Structure of the problem (variables and constraints shapes), used to know if the QP matrices
+  // have the same sparsity pattern as in the previous solve
+  std::vector<int> new_structure = { n_variables, rewrite_equalities, use_sparsity };
+
+  for (auto constraint : constraints)
+  {
+    new_structure.insert(new_structure.end(), { constraint->type, constraint->priority, constraint->expression.rows(),
+                                                constraint->expression.cols() });
+
+    if (constraint->type == ProblemConstraint::Inequality)
+    {
+      if (constraint->priority == ProblemConstraint::Soft)
+      {
+        slack_variables += constraint->expression.rows();
+      }
+    }
+    else if (constraint->priority == ProblemConstraint::Hard)
+    {
+      n_equalities += constraint->expression.rows();
+    }
+  }
+
+  reset_activity();
+
+  // Equality constraints
+  Eigen::MatrixXd A;
+  Eigen::VectorXd b;
+  build_equalities(A, b);
+
+  free_variables = n_variables;
+  determined_variables = 0;
+  qr_reused = false;
+
+  if (rewrite_equalities && A.rows() > 0)
+  {
+    compute_equalities_nullspace(A, b);
+    project_constraints();
+
+    // Removing equality constraints
+    n_equalities = 0.;
+    A.resize(0, 0);
+    b.resize(0);
+  }
+
+  structure_reused = reuse_structure && (new_structure == structure);
+
+  // P and q are accumulated and always need to be zeroed, resizing them is a no-op if their size is unchanged
+  P.resize(free_variables + slack_variables, free_variables + slack_variables);
+  q.resize(free_variables + slack_variables);
+
+  P.setZero();
+  q.setZero();
+
+  // Adding regularization
+  P.block(0, 0, free_variables, free_variables).setIdentity();
+  P.block(0, 0, free_variables, free_variables) *= regularization;
+
+  // Keeping track of the changes of the soft constraints hessians and weights, see incremental_objective
+  int hessian_changes = 0;
+  int weight_changes = 0;
+  rank_update_constraint = -1;
+  if (incremental_objective)
+  {
+    soft_contributions.resize(constraints.size());
+  }
+
+  // Scanning the constraints (counting inequalities and equalities, building objectif function)
+  for (size_t index = 0; index < constraints.size(); index++)
+  {
+    ProblemConstraint* constraint = constraints[index];
+    if (constraint->expression.cols() > n_variables)
+    {
+      throw QPError("Problem: Inconsistent problem size");
+    }
+    if (constraint->expression.A.rows() == 0 || constraint->expression.b.rows() == 0)
+    {
+      throw QPError("Problem: A or b is empty");
+    }
+    if (constraint->expression.A.rows() != constraint->expression.b.rows())
+    {
+      throw QPError("Problem: A.rows() != b.rows()");
+    }
+
+    if (constraint->type == ProblemConstraint::Inequality)
+    {
+      // If the constraint is hard, this will be the true inequality, else, this will be the inequality
+      // enforcing the slack variable to be >= 0
+      n_inequalities += constraint->expression.rows();
+    }
+    else if (constraint->priority == ProblemConstraint::Soft)
+    {
+      Eigen::MatrixXd expression_A;
+      Eigen::MatrixXd expression_b;
+      get_constraint_expressions(index, expression_A, expression_b);
+
+      // Adding the soft constraint to the objective function
+      int n = expression_A.cols();
+      Sparsity sparsity;
+      if (use_sparsity)
+      {
+        // Once the expression is projected in the equalities nullspace, the declared sparsity is carried through the
+        // projection
+        if (constraint->sparsity.intervals.empty())
+        {
+          sparsity = Sparsity::detect_columns_sparsity(expression_A);
+        }
+        else if (determined_variables > 0)
+        {
+          sparsity = projected_sparsity(constraint->sparsity, nullspace_sparsity, n);
+        }
+        else
+        {
+          sparsity = constraint->sparsity;
+        }
+      }
+      else
+      {
+        sparsity.add_interval(0, n - 1);
+      }
+
+      if (incremental_objective)
+      {
+        // The hessian blocks of the constraint are computed again only if A changed
+        SoftContribution& contribution = soft_contributions[index];
+        if (contribution.A.rows() == expression_A.rows() && contribution.A.cols() == n &&
+            contribution.A == expression_A)
+        {
+          if (contribution.weight != constraint->weight)
+          {
+            weight_changes += 1;
+            rank_update_constraint = index;
+            rank_update_weight = constraint->weight - contribution.weight;
+          }
+        }
+        else
+        {
+          hessian_changes += 1;
+          contribution.A = expression_A;
+          contribution.sparsity = sparsity;
+          contribution.blocks.clear();
+          for_each_hessian_block(sparsity, n, [&](int start_i, int size_i, int start_j, int size_j) {
+            contribution.blocks.push_back(expression_A.middleCols(start_i, size_i).transpose() *
+                                          expression_A.middleCols(start_j, size_j));
+          });
+        }
+        contribution.weight = constraint->weight;
+
+        int block = 0;
+        for_each_hessian_block(contribution.sparsity, n, [&](int start_i, int size_i, int start_j, int size_j) {
+          P.block(start_i, start_j, size_i, size_j) += constraint->weight * contribution.blocks[block];
+          block += 1;
+        });
+      }
+      else
+      {
+        // P only receives the (possibly off-diagonal) blocks of the non-zero columns
+        for_each_hessian_block(sparsity, n, [&](int start_i, int size_i, int start_j, int size_j) {
+          P.block(start_i, start_j, size_i, size_j).noalias() +=
+              constraint->weight *
+              (expression_A.middleCols(start_i, size_i).transpose() * expression_A.middleCols(start_j, size_j));
+        });
+      }
+
+      q.head(n).noalias() += constraint->weight * (expression_A.transpose() * expression_b);
+    }
+  }
+
+  // If P only differs from the previous one (factorized by the direct solve) by the weight of one constraint, the
+  // factorization can be updated instead of being computed again
+  if (!(incremental_objective && structure_reused && direct_solved && hessian_changes == 0 && weight_changes == 1 &&
+        regularization == objective_regularization))
+  {
+    rank_update_constraint = -1;
+  }
+  objective_regularization = regularization;
+
+  // Inequality constraints. If the structure is the same as in the previous solve, non-zero entries of G and h
+  // will be overwritten at the same places, they don't need to be cleared.
+  if (!structure_reused)
+  {
+    G.resize(n_inequalities, free_variables + slack_variables);
+    h.resize(n_inequalities);
+    G.setZero();
+    h.setZero();
+  }
+
+  // Used to keep track of the hard/soft inequalities constraints, the rows enforcing the slack variables positivity
+  // are not mapped to any constraint
+  inequalities_mapping.assign(n_inequalities, RowMapping());
+  slacks_mapping.assign(slack_variables, RowMapping());
+
+  int k_inequality = 0;
+  int k_slack = 0;
+
+  // Slack variables should be positive
+  for (int slack = 0; slack < slack_variables; slack += 1)
+  {
+    // s_i >= 0
+    G(k_inequality, free_variables + slack) = 1;
+    k_inequality += 1;
+  }
+
+  for (size_t index = 0; index < constraints.size(); index++)
+  {
+    ProblemConstraint* constraint = constraints[index];
+    if (constraint->type == ProblemConstraint::Inequality)
+    {
+      Eigen::MatrixXd expression_A;
+      Eigen::MatrixXd expression_b;
+      get_constraint_expressions(index, expression_A, expression_b);
+
+      if (constraint->priority == ProblemConstraint::Hard)
+      {
+        // Ax + b >= 0
+        G.block(k_inequality, 0, expression_A.rows(), expression_A.cols()) = expression_A;
+        h.block(k_inequality, 0, expression_b.rows(), 1) = expression_b;
+
+        for (int k = 0; k < expression_A.rows(); k++)
+        {
+          inequalities_mapping[k_inequality + k] = { constraint, k };
+        }
+        k_inequality += expression_A.rows();
+      }
+      else
+      {
+        // min(Ax + b - s)
+        // A slack variable is assigend with all "soft" inequality and a minimization is added to the problem
+        // With As = [A -I], the contribution As^T As is added block by block
+        int n = expression_A.cols();
+        int rows = expression_A.rows();
+        int slack_start = free_variables + k_slack;
+        double weight = constraint->weight;
+
+        P.block(0, 0, n, n).noalias() += weight * (expression_A.transpose() * expression_A);
+        P.block(0, slack_start, n, rows) -= weight * expression_A.transpose();
+        P.block(slack_start, 0, rows, n) -= weight * expression_A;
+        P.block(slack_start, slack_start, rows, rows).diagonal().array() += weight;
+        q.head(n).noalias() += weight * (expression_A.transpose() * expression_b);
+        q.segment(slack_start, rows) -= weight * expression_b;
+
+        for (int k = 0; k < rows; k++)
+        {
+          slacks_mapping[k_slack] = { constraint, k };
+          k_slack += 1;
+        }
+      }
+    }
+  }
+
+  // G and h are now consistent with this structure
+  structure = new_structure;
+
+  Eigen::VectorXi active_set;
+  size_t active_set_size;
+
+  Eigen::VectorXd qp_x(free_variables + slack_variables);
+  Eigen::VectorXd qp_duals;
+  qp_x.setZero();
+  double result = 0.;
+
+  warm_started = false;
+  warm_start_iterations = 0;
+  direct_solved = false;
+  factorization_reused = false;
+  if (direct_solve && G.rows() == 0)
+  {
+    direct_solved = solve_direct(P, q, A, b, qp_x, qp_duals, active_set, active_set_size);
+  }
+
+  if (!direct_solved && warm_start)
+  {
+    warm_started = solve_warm_start(P, q, A, b, G, h, qp_x, qp_duals, active_set, active_set_size);
+  }
+
+  if (!direct_solved && !warm_started)
+  {
+    qp_x.setZero();
+    result = eiquadprog::solvers::solve_quadprog(P, q, A.transpose(), b, G.transpose(), h, qp_x, qp_duals,
+                                                 active_set, active_set_size);
+  }
+
+  // Keeping track of active inequalities for the next warm start
+  this->active_set_size = active_set_size;
+  previous_active_set.clear();
+  previous_shape = Eigen::Vector3i(P.rows(), A.rows(), G.rows());
+  if (result != std::numeric_limits<double>::infinity())
+  {
+    for (int k = 0; k < active_set_size; k++)
+    {
+      if (active_set[k] >= 0)
+      {
+        previous_active_set.push_back(active_set[k]);
+      }
+    }
+  }
+
+  if (determined_variables)
+  {
+    x = x_determined;
+    x.noalias() += Q.rightCols(free_variables) * qp_x.topRows(free_variables);
+  }
+  else
+  {
+    x = qp_x;
+  }
+
+  // Checking that the problem is indeed feasible
+  if (result == std::numeric_limits<double>::infinity())
+  {
+    throw QPError("Problem: Infeasible QP (check your hard inequality constraints)");
+  }
+
+  // Checking that equality constraints were enforced, since this is not covered by above result
+  if (A.rows() > 0)
+  {
+    Eigen::VectorXd equality_constraints = A * x.topRows(A.cols()) + b;
+    for (int k = 0; k < A.rows(); k++)
+    {
+      if (fabs(equality_constraints[k]) > 1e-6)
+      {
+        throw QPError("Problem: Infeasible QP (equality constraints were not enforced)");
+      }
+    }
+  }
+
+  // Checking for NaNs in solution
+  if (x.hasNaN())
+  {
+    throw QPError("Problem: NaN in the QP solution");
+  }
+
+  // Reporting on the active constraints
+  for (int k = 0; k < active_set_size; k++)
+  {
+    int active_constraint = active_set[k];
+
+    if (active_constraint >= 0)
+    {
+      set_active(inequalities_mapping[active_constraint]);
+      set_dual(inequalities_mapping[active_constraint], qp_duals(k));
+    }
+    else
+    {
+      set_dual(equalities_mapping[-active_constraint - 1], qp_duals(k));
+    }
+  }
+
+  // The active set is not ordered
+  for (auto constraint : constraints)
+  {
+    std::sort(constraint->active_rows.begin(), constraint->active_rows.end());
+  }
+
+  slacks = qp_x.block(free_variables, 0, slack_variables, 1);
+  for (int k = 0; k < slacks.rows(); k++)
+  {
+    if (slacks[k] <= 1e-6)
+    {
+      set_active(slacks_mapping[k]);
+    }
+  }
+
+  compute_soft_duals();
+
+  if (determined_variables)
+  {
+    // The hard equalities were removed from the QP, their multipliers are recovered from the stationarity condition
+    // A^T lambda = grad(regularization) - sum of the other constraints A_i^T lambda_i, using A^T P = Q R
+    Eigen::VectorXd gradient = regularization * (Q.rightCols(free_variables) * qp_x.head(free_variables));
+    for (auto constraint : constraints)
+    {
+      if (constraint->type != ProblemConstraint::Equality || constraint->priority != ProblemConstraint::Hard)
+      {
+        const Expression& expression = constraint->expression;
+        gradient.head(expression.cols()).noalias() -= expression.A.transpose() * constraint->duals;
+      }
+    }
+
+    Eigen::VectorXd lambda = QR.matrixR()
+                                 .topLeftCorner(determined_variables, determined_variables)
+                                 .triangularView<Eigen::Upper>()
+                                 .solve(Q.leftCols(determined_variables).transpose() * gradient);
+    lambda = QR.colsPermutation() * lambda;
+
+    for (int k = 0; k < lambda.rows(); k++)
+    {
+      set_dual(equalities_mapping[k], lambda(k));
+    }
+  }
+
+  for (auto variable : variables)
+  {
+    variable->version += 1;
+    variable->value = Eigen::VectorXd(variable->size());
+    variable->value = x.block(variable->k_start, 0, variable->size(), 1);
+  }
+
+  solve_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Problem::solve_hierarchical()
+{
+  n_equalities = 0;
+  n_inequalities = 0;
+  slack_variables = 0;
+  free_variables = n_variables;
+  determined_variables = 0;
+  structure_reused = false;
+  qr_reused = false;
+  warm_started = false;
+  warm_start_iterations = 0;
+  direct_solved = false;
+  factorization_reused = false;
+  levels_solve_times.clear();
+
+  // P and G are re-allocated here, the dense solver should not assume they have the previous structure
+  structure.clear();
+
+  std::vector<int> levels;
+  int hard_inequalities = 0;
+
+  for (auto constraint : constraints)
+  {
+    if (constraint->expression.cols() > n_variables)
+    {
+      throw QPError("Problem: Inconsistent problem size");
+    }
+    if (constraint->expression.A.rows() == 0 || constraint->expression.b.rows() == 0)
+    {
+      throw QPError("Problem: A or b is empty");
+    }
+    if (constraint->expression.A.rows() != constraint->expression.b.rows())
+    {
+      throw QPError("Problem: A.rows() != b.rows()");
+    }
+
+    if (constraint->priority == ProblemConstraint::Soft)
+    {
+      levels.push_back(constraint->level);
+    }
+    else if (constraint->type == ProblemConstraint::Equality)
+    {
+      n_equalities += constraint->expression.rows();
+    }
+    else
+    {
+      hard_inequalities += constraint->expression.rows();
+    }
+  }
+
+  std::sort(levels.begin(), levels.end());
+  levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+  if (levels.empty())
+  {
+    // The hard inequalities still have to be enforced
+    levels.push_back(0);
+  }
+
+  reset_activity();
+
+  // The solution is searched as x = x_level + Z z, starting with the nullspace of the hard equalities
+  Eigen::VectorXd x_level;
+  Eigen::MatrixXd Z;
+
+  if (n_equalities > 0)
+  {
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    build_equalities(A, b);
+    compute_equalities_nullspace(A, b);
+
+    x_level = x_determined;
+    Z = Q.rightCols(free_variables);
+  }
+  else
+  {
+    x_level = Eigen::VectorXd::Zero(n_variables);
+    Z = Eigen::MatrixXd::Identity(n_variables, n_variables);
+  }
+
+  // Inequalities G_x x + h_x >= 0 enforced at all levels: the hard ones first, and then the soft inequalities of the
+  // levels already solved, relaxed to their optimal violation
+  Eigen::MatrixXd G_x = Eigen::MatrixXd::Zero(hard_inequalities, n_variables);
+  Eigen::VectorXd h_x(hard_inequalities);
+  inequalities_mapping.assign(hard_inequalities, RowMapping());
+
+  int k_inequality = 0;
+  for (auto constraint : constraints)
+  {
+    if (constraint->type == ProblemConstraint::Inequality && constraint->priority == ProblemConstraint::Hard)
+    {
+      const Expression& expression = constraint->expression;
+      G_x.block(k_inequality, 0, expression.rows(), expression.cols()) = expression.A;
+      h_x.segment(k_inequality, expression.rows()) = expression.b;
+      for (int k = 0; k < expression.rows(); k++)
+      {
+        inequalities_mapping[k_inequality + k] = { constraint, k };
+      }
+      k_inequality += expression.rows();
+    }
+  }
+
+  Eigen::VectorXd qp_duals;
+  Eigen::VectorXi active_set;
+  size_t active_set_size = 0;
+
+  for (int level : levels)
+  {
+    auto level_start = std::chrono::steady_clock::now();
+    int r = Z.cols();
+
+    // Counting the slack variables and the soft equalities of this level
+    int level_slacks = 0;
+    int level_equalities = 0;
+    for (auto constraint : constraints)
+    {
+      if (constraint->priority == ProblemConstraint::Soft && constraint->level == level)
+      {
+        if (constraint->type == ProblemConstraint::Inequality)
+        {
+          level_slacks += constraint->expression.rows();
+        }
+        else
+        {
+          level_equalities += constraint->expression.rows();
+        }
+      }
+    }
+
+    // Objective and inequalities for this level, expressed in z (and the slack variables)
+    int n = r + level_slacks;
+    P.setZero(n, n);
+    q.setZero(n);
+    P.topLeftCorner(r, r).diagonal().setConstant(regularization);
+
+    G.setZero(G_x.rows() + level_slacks, n);
+    h.setZero(G_x.rows() + level_slacks);
+    G.topLeftCorner(G_x.rows(), r).noalias() = G_x * Z;
+    h.head(G_x.rows()) = h_x;
+    h.head(G_x.rows()).noalias() += G_x * x_level;
+
+    // Soft equalities of this level, in z, used to restrict the nullspace afterwards
+    Eigen::MatrixXd level_A(level_equalities, r);
+    int k_level = 0;
+    int k_slack = 0;
+
+    for (auto constraint : constraints)
+    {
+      if (constraint->priority != ProblemConstraint::Soft || constraint->level != level)
+      {
+        continue;
+      }
+
+      const Expression& expression = constraint->expression;
+      int rows = expression.rows();
+      double weight = constraint->weight;
+      Eigen::MatrixXd expression_A = expression.A * Z.topRows(expression.cols());
+      Eigen::VectorXd expression_b = expression.b;
+      expression_b.noalias() += expression.A * x_level.head(expression.cols());
+
+      P.topLeftCorner(r, r).noalias() += weight * (expression_A.transpose() * expression_A);
+      q.head(r).noalias() += weight * (expression_A.transpose() * expression_b);
+
+      if (constraint->type == ProblemConstraint::Equality)
+      {
+        level_A.middleRows(k_level, rows) = expression_A;
+        k_level += rows;
+      }
+      else
+      {
+        // min(Ax + b - s), with s >= 0
+        int slack_start = r + k_slack;
+        P.block(0, slack_start, r, rows) -= weight * expression_A.transpose();
+        P.block(slack_start, 0, rows, r) -= weight * expression_A;
+        P.block(slack_start, slack_start, rows, rows).diagonal().array() += weight;
+        q.segment(slack_start, rows) -= weight * expression_b;
+
+        for (int k = 0; k < rows; k++)
+        {
+          G(G_x.rows() + k_slack + k, slack_start + k) = 1.;
+        }
+        k_slack += rows;
+      }
+    }
+
+    if (r > 0)
+    {
+      Eigen::VectorXd qp_x(n);
+      Eigen::MatrixXd CE(n, 0);
+      Eigen::VectorXd ce(0);
+      double result = eiquadprog::solvers::solve_quadprog(P, q, CE, ce, G.transpose(), h, qp_x, qp_duals, active_set,
+                                                          active_set_size);
+
+      if (result == std::numeric_limits<double>::infinity())
+      {
+        throw QPError("Problem: Infeasible QP (check your hard inequality constraints)");
+      }
+
+      x_level.noalias() += Z * qp_x.head(r);
+    }
+    else
+    {
+      active_set_size = 0;
+    }
+
+    // The soft equalities of this level should keep their optimal values, the search is restricted to their
+    // nullspace (the factorization of this level is applied to the current basis)
+    if (level_equalities > 0 && r > 0)
+    {
+      Eigen::ColPivHouseholderQR<Eigen::MatrixXd> level_QR(level_A.transpose());
+      level_QR.setThreshold(1e-8);
+      int rank = level_QR.rank();
+
+      if (rank > 0)
+      {
+        Eigen::MatrixXd level_Q = level_QR.householderQ();
+        Z = (Z * level_Q.rightCols(r - rank)).eval();
+      }
+    }
+
+    // The soft inequalities of this level are relaxed to their optimal violation: Ax + b >= min(Ax* + b, 0)
+    if (level_slacks > 0)
+    {
+      int rows = G_x.rows();
+      G_x.conservativeResize(rows + level_slacks, Eigen::NoChange);
+      h_x.conservativeResize(rows + level_slacks);
+      G_x.bottomRows(level_slacks).setZero();
+
+      for (auto constraint : constraints)
+      {
+        if (constraint->priority == ProblemConstraint::Soft && constraint->level == level &&
+            constraint->type == ProblemConstraint::Inequality)
+        {
+          const Expression& expression = constraint->expression;
+          Eigen::VectorXd value = expression.b;
+          value.noalias() += expression.A * x_level.head(expression.cols());
+
+          G_x.block(rows, 0, expression.rows(), expression.cols()) = expression.A;
+          h_x.segment(rows, expression.rows()) = expression.b - value.cwiseMin(0.);
+          rows += expression.rows();
+        }
+      }
+    }
+
+    levels_solve_times.push_back(
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - level_start).count());
+  }
+
+  x = x_level;
+
+  // Checking that the hard inequalities are enforced (the last levels may have no freedom left)
+  Eigen::VectorXd hard_values = h_x.head(hard_inequalities);
+  hard_values.noalias() += G_x.topRows(hard_inequalities) * x;
+  if (hard_inequalities > 0 && hard_values.minCoeff() < -1e-6)
+  {
+    throw QPError("Problem: Infeasible QP (check your hard inequality constraints)");
+  }
+
+  if (x.hasNaN())
+  {
+    throw QPError("Problem: NaN in the QP solution");
+  }
+
+  // Reporting on the active constraints, the multipliers of hard inequalities are the ones of the last level
+  n_inequalities = hard_inequalities;
+  this->active_set_size = n_equalities;
+  for (int k = 0; k < hard_inequalities; k++)
+  {
+    if (hard_values(k) <= 1e-6)
+    {
+      set_active(inequalities_mapping[k]);
+      this->active_set_size += 1;
+    }
+  }
+  for (int k = 0; k < (int)active_set_size; k++)
+  {
+    if (active_set[k] >= 0 && active_set[k] < hard_inequalities)
+    {
+      set_dual(inequalities_mapping[active_set[k]], qp_duals(k));
+    }
+  }
+
+  // Slack variables of soft inequalities are their positive parts
+  for (auto constraint : constraints)
+  {
+    if (constraint->priority == ProblemConstraint::Soft && constraint->type == ProblemConstraint::Inequality)
+    {
+      slack_variables += constraint->expression.rows();
+    }
+  }
+
+  slacks.resize(slack_variables);
+  slacks_mapping.assign(slack_variables, RowMapping());
+  int k_slack = 0;
+
+  for (auto constraint : constraints)
+  {
+    if (constraint->priority == ProblemConstraint::Soft && constraint->type == ProblemConstraint::Inequality)
+    {
+      const Expression& expression = constraint->expression;
+      Eigen::VectorXd value = expression.b;
+      value.noalias() += expression.A * x.head(expression.cols());
+
+      for (int k = 0; k < expression.rows(); k++)
+      {
+        slacks(k_slack) = std::max(value(k), 0.);
+        slacks_mapping[k_slack] = { constraint, k };
+        if (value(k) <= 1e-6)
+        {
+          set_active(slacks_mapping[k_slack]);
+        }
+        k_slack += 1;
+      }
+    }
+  }
+
+  compute_soft_duals();
+
+  for (auto variable : variables)
+  {
+    variable->version += 1;
+    variable->value = x.block(variable->k_start, 0, variable->size(), 1);
+  }
+}
+
+// Appends the non-zero entries of M (scaled) as triplets, starting at the given row
+static void add_sparse_rows(std::vector<Eigen::Triplet<double>>& triplets, int row, Eigen::Ref<const Eigen::MatrixXd> M,
+                            double scale)
+{
+  Sparsity sparsity = Sparsity::detect_columns_sparsity(M);
+
+  for (auto& interval : sparsity.intervals)
+  {
+    for (int column = interval.start; column <= interval.end; column++)
+    {
+      for (int k = 0; k < M.rows(); k++)
+      {
+        if (M(k, column) != 0.)
+        {
+          triplets.push_back(Eigen::Triplet<double>(row + k, column, scale * M(k, column)));
+        }
+      }
+    }
+  }
+}
+
+void Problem::solve_admm()
+{
+  n_equalities = 0;
+  n_inequalities = 0;
+  slack_variables = 0;
+  free_variables = n_variables;
+  determined_variables = 0;
+  structure_reused = false;
+  qr_reused = false;
+  warm_started = false;
+  warm_start_iterations = 0;
+  direct_solved = false;
+  factorization_reused = false;
+
+  // Counting the objective rows, the constraints rows and the slack variables
+  int objective_rows = 0;
+
+  for (auto constraint : constraints)
+  {
+    if (constraint->expression.cols() > n_variables)
+    {
+      throw QPError("Problem: Inconsistent problem size");
+    }
+    if (constraint->expression.A.rows() == 0 || constraint->expression.b.rows() == 0)
+    {
+      throw QPError("Problem: A or b is empty");
+    }
+    if (constraint->expression.A.rows() != constraint->expression.b.rows())
+    {
+      throw QPError("Problem: A.rows() != b.rows()");
+    }
+
+    int rows = constraint->expression.rows();
+
+    if (constraint->type == ProblemConstraint::Inequality)
+    {
+      n_inequalities += rows;
+
+      if (constraint->priority == ProblemConstraint::Soft)
+      {
+        slack_variables += rows;
+        objective_rows += rows;
+      }
+    }
+    else
+    {
+      if (constraint->priority == ProblemConstraint::Hard)
+      {
+        n_equalities += rows;
+      }
+      else
+      {
+        objective_rows += rows;
+      }
+    }
+  }
+
+  // Soft constraints are stacked (weighted by sqrt(w)) in a matrix M so that the objective is 1/2 ||Mz + m||^2,
+  // hard constraints are stacked in C with l <= Cz <= u. z is the variables followed by the slack variables.
+  int n = n_variables + slack_variables;
+  int constraint_rows = n_equalities + n_inequalities;
+  double infinity = std::numeric_limits<double>::infinity();
+
+  std::vector<Eigen::Triplet<double>> objective_triplets;
+  std::vector<Eigen::Triplet<double>> constraint_triplets;
+  Eigen::VectorXd m(objective_rows);
+  Eigen::VectorXd l(constraint_rows);
+  Eigen::VectorXd u(constraint_rows);
+
+  // Constraint rows mapping, equality rows and rows enforcing the slack variables positivity are not mapped
+  reset_activity();
+  inequalities_mapping.assign(constraint_rows, RowMapping());
+  slacks_mapping.assign(slack_variables, RowMapping());
+
+  int k_objective = 0;
+  int k_constraint = 0;
+  int k_slack = 0;
+
+  for (auto constraint : constraints)
+  {
+    const Expression& expression = constraint->expression;
+    int rows = expression.rows();
+
+    if (constraint->priority == ProblemConstraint::Soft)
+    {
+      double scale = sqrt(constraint->weight);
+      add_sparse_rows(objective_triplets, k_objective, expression.A, scale);
+      m.segment(k_objective, rows) = scale * expression.b;
+
+      if (constraint->type == ProblemConstraint::Inequality)
+      {
+        // min ||Ax + b - s||^2, with s >= 0
+        for (int k = 0; k < rows; k++)
+        {
+          objective_triplets.push_back(Eigen::Triplet<double>(k_objective + k, n_variables + k_slack, -scale));
+          constraint_triplets.push_back(Eigen::Triplet<double>(k_constraint, n_variables + k_slack, 1.));
+          l(k_constraint) = 0.;
+          u(k_constraint) = infinity;
+          slacks_mapping[k_slack] = { constraint, k };
+          k_constraint += 1;
+          k_slack += 1;
+        }
+      }
+
+      k_objective += rows;
+    }
+    else
+    {
+      add_sparse_rows(constraint_triplets, k_constraint, expression.A, 1.);
+      l.segment(k_constraint, rows) = -expression.b;
+
+      if (constraint->type == ProblemConstraint::Equality)
+      {
+        // Ax + b = 0
+        u.segment(k_constraint, rows) = -expression.b;
+      }
+      else
+      {
+        // Ax + b >= 0
+        u.segment(k_constraint, rows).setConstant(infinity);
+        for (int k = 0; k < rows; k++)
+        {
+          inequalities_mapping[k_constraint + k] = { constraint, k };
+        }
+      }
+
+      k_constraint += rows;
+    }
+  }
+
+  ADMMSolver::SparseMatrix M(objective_rows, n);
+  M.setFromTriplets(objective_triplets.begin(), objective_triplets.end());
+
+  ADMMSolver::SparseMatrix C(constraint_rows, n);
+  C.setFromTriplets(constraint_triplets.begin(), constraint_triplets.end());
+
+  ADMMSolver::SparseMatrix R(n, n);
+  for (int k = 0; k < n_variables; k++)
+  {
+    R.insert(k, k) = regularization;
+  }
+
+  ADMMSolver::SparseMatrix P_sparse = ADMMSolver::SparseMatrix(M.transpose()) * M;
+  P_sparse += R;
+  Eigen::VectorXd q_sparse = M.transpose() * m;
+
+  admm.warm_start = warm_start;
+  if (!admm.solve(P_sparse, q_sparse, C, l, u))
+  {
+    throw QPError("Problem: ADMM solver did not converge (infeasible QP or not enough iterations)");
+  }
+
+  x = admm.x.head(n_variables);
+  slacks = admm.x.tail(slack_variables);
+
+  // Checking for NaNs in solution
+  if (x.hasNaN())
+  {
+    throw QPError("Problem: NaN in the QP solution");
+  }
+
+  // Reporting on the active constraints, a row is active if it has a (negative) multiplier
+  active_set_size = n_equalities;
+  for (int k = 0; k < constraint_rows; k++)
+  {
+    if (inequalities_mapping[k].constraint != nullptr && admm.y(k) < 0.)
+    {
+      set_active(inequalities_mapping[k]);
+      active_set_size += 1;
+    }
+  }
+
+  for (int k = 0; k < slacks.rows(); k++)
+  {
+    if (slacks[k] <= 1e-6)
+    {
+      set_active(slacks_mapping[k]);
+    }
+  }
+
+  // Multipliers of the hard constraints, following the same rows order as above (OSQP convention has the opposite
+  // sign)
+  k_constraint = 0;
+  for (auto constraint : constraints)
+  {
+    int rows = constraint->expression.rows();
+
+    if (constraint->priority == ProblemConstraint::Hard)
+    {
+      constraint->duals = -admm.y.segment(k_constraint, rows);
+      k_constraint += rows;
+    }
+    else if (constraint->type == ProblemConstraint::Inequality)
+    {
+      k_constraint += rows;
+    }
+  }
+
+  compute_soft_duals();
+
+  for (auto variable : variables)
+  {
+    variable->version += 1;
+    variable->value = x.block(variable->k_start, 0, variable->size(), 1);
+  }
+}
+
+bool Problem::solve_riccati()
+{
+  if (variables.size() == 0)
+  {
+    return false;
+  }
+
+  // All the variables should be integrator inputs over the same horizon, the stage-wise system is then block
+  // diagonal, with one input per variable
+  int N = variables[0]->size();
+  int nx = 0;
+  int nu = variables.size();
+  std::vector<int> state_offsets;
+
+  for (auto variable : variables)
+  {
+    if (variable->integrator_A.rows() == 0 || variable->size() != N)
+    {
+      return false;
+    }
+    state_offsets.push_back(nx);
+    nx += variable->integrator_A.rows();
+  }
+
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(nx, nx);
+  Eigen::MatrixXd B = Eigen::MatrixXd::Zero(nx, nu);
+  Eigen::VectorXd s0(nx);
+
+  // For each variable, free response A^k X0 (one column per stage) and controllability matrix (row j is (A^j B)^T)
+  std::vector<Eigen::MatrixXd> free_responses(nu);
+  std::vector<Eigen::MatrixXd> controllabilities(nu);
+
+  for (int v = 0; v < nu; v++)
+  {
+    Variable* variable = variables[v];
+    int order = variable->integrator_A.rows();
+    A.block(state_offsets[v], state_offsets[v], order, order) = variable->integrator_A;
+    B.block(state_offsets[v], v, order, 1) = variable->integrator_B;
+    s0.segment(state_offsets[v], order) = variable->integrator_X0;
+
+    free_responses[v].resize(order, N + 1);
+    free_responses[v].col(0) = variable->integrator_X0;
+    for (int k = 0; k < N; k++)
+    {
+      free_responses[v].col(k + 1) = variable->integrator_A * free_responses[v].col(k);
+    }
+
+    controllabilities[v].resize(order, order);
+    Eigen::VectorXd AjB = variable->integrator_B;
+    for (int j = 0; j < order; j++)
+    {
+      controllabilities[v].row(j) = AjB.transpose();
+      AjB = variable->integrator_A * AjB;
+    }
+  }
+
+  riccati.setup(A, B, s0, N);
+
+  // Rewrites a row Ax + b of an expression as r^T [s_k, u_k] + e, where k is the last stage whose input appears
+  // in the row. Coefficients on previous inputs u_i should then be c^T A^(k-1-i) B
+  auto stage_row = [&](const Expression& expression, int row, RiccatiSolver::Row& stage_row) {
+    stage_row.stage = 0;
+    stage_row.r = Eigen::VectorXd::Zero(nx + nu);
+    stage_row.e = expression.b(row);
+    double tolerance = 1e-8 * (1. + expression.A.row(row).lpNorm<Eigen::Infinity>());
+
+    for (auto variable : variables)
+    {
+      for (int column = std::min(variable->k_end, expression.cols()) - 1; column >= variable->k_start; column--)
+      {
+        if (expression.A(row, column) != 0.)
+        {
+          stage_row.stage = std::max(stage_row.stage, column - variable->k_start);
+          break;
+        }
+      }
+    }
+    int k = stage_row.stage;
+
+    for (int v = 0; v < nu; v++)
+    {
+      Variable* variable = variables[v];
+      int order = variable->integrator_A.rows();
+      auto a = [&](int i) {
+        int column = variable->k_start + i;
+        return column < expression.cols() ? expression.A(row, column) : 0.;
+      };
+
+      stage_row.r(nx + v) = a(k);
+
+      int equations = std::min(k, order);
+      if (equations > 0)
+      {
+        Eigen::VectorXd rhs(equations);
+        for (int j = 0; j < equations; j++)
+        {
+          rhs(j) = a(k - 1 - j);
+        }
+        Eigen::VectorXd c = controllabilities[v].topRows(equations).completeOrthogonalDecomposition().solve(rhs);
+
+        // Checking that all the coefficients are explained by c
+        Eigen::VectorXd w = c;
+        for (int j = 0; j < k; j++)
+        {
+          if (fabs(w.dot(variable->integrator_B) - a(k - 1 - j)) > tolerance)
+          {
+            return false;
+          }
+          w = variable->integrator_A.transpose() * w;
+        }
+
+        stage_row.r.segment(state_offsets[v], order) = c;
+        stage_row.e -= c.dot(free_responses[v].col(k));
+      }
+    }
+
+    return true;
+  };
+
+  n_equalities = 0;
+  n_inequalities = 0;
+  inequalities_mapping.clear();
+  equalities_mapping.clear();
+
+  for (auto constraint : constraints)
+  {
+    if (constraint->type == ProblemConstraint::Inequality && constraint->priority == ProblemConstraint::Soft)
+    {
+      return false;
+    }
+    if (constraint->expression.cols() > n_variables)
+    {
+      throw QPError("Problem: Inconsistent problem size");
+    }
+
+    for (int row = 0; row < constraint->expression.rows(); row++)
+    {
+      RiccatiSolver::Row stage_constraint;
+      if (!stage_row(constraint->expression, row, stage_constraint))
+      {
+        return false;
+      }
+
+      if (constraint->type == ProblemConstraint::Inequality)
+      {
+        // r^T z_k + e >= 0
+        riccati.inequalities.push_back(stage_constraint);
+        inequalities_mapping.push_back({ constraint, row });
+        n_inequalities += 1;
+      }
+      else if (constraint->priority == ProblemConstraint::Hard)
+      {
+        // r^T z_k + e = 0
+        riccati.equalities.push_back(stage_constraint);
+        equalities_mapping.push_back({ constraint, row });
+        n_equalities += 1;
+      }
+      else
+      {
+        // Adding w/2 (r^T z_k + e)^2 to the objective
+        int k = stage_constraint.stage;
+        riccati.H[k].noalias() += constraint->weight * stage_constraint.r * stage_constraint.r.transpose();
+        riccati.h[k] += constraint->weight * stage_constraint.e * stage_constraint.r;
+      }
+    }
+  }
+
+  for (int k = 0; k < N; k++)
+  {
+    riccati.H[k].bottomRightCorner(nu, nu).diagonal().array() += regularization;
+  }
+
+  riccati.solve();
+
+  free_variables = n_variables;
+  determined_variables = 0;
+  slack_variables = 0;
+  structure_reused = false;
+  qr_reused = false;
+  warm_started = false;
+  warm_start_iterations = 0;
+  direct_solved = false;
+  factorization_reused = false;
+  slacks.resize(0);
+
+  x.resize(n_variables);
+  for (int v = 0; v < nu; v++)
+  {
+    x.segment(variables[v]->k_start, N) = riccati.inputs.row(v).transpose();
+  }
+
+  if (x.hasNaN())
+  {
+    throw QPError("Problem: NaN in the QP solution");
+  }
+
+  // Reporting on the active constraints
+  active_set_size = n_equalities;
+  reset_activity();
+  for (int k = 0; k < n_inequalities; k++)
+  {
+    if (riccati.inequalities_values(k) <= 1e-6)
+    {
+      set_active(inequalities_mapping[k]);
+      active_set_size += 1;
+    }
+    set_dual(inequalities_mapping[k], riccati.inequalities_multipliers(k));
+  }
+
+  for (int k = 0; k < n_equalities; k++)
+  {
+    set_dual(equalities_mapping[k], riccati.equalities_multipliers(k));
+  }
+
+  compute_soft_duals();
+
+  for (auto variable : variables)
+  {
+    variable->version += 1;
+    variable->value = x.block(variable->k_start, 0, variable->size(), 1);
+  }
+
+  return true;
+}
+
+void Problem::dump_status()
 {
   std::cout << "Problem status:" << std::endl;
   std::cout << "  - Variables: " << n_variables << std::endl;
@@ -401,6 +1833,10 @@ void Problem::dump_status()
   {
     std::cout << "  - Determined variables: " << determined_variables << std::endl;
     std::cout << "  - Free variables: " << free_variables << std::endl;
+    if (qr_reused)
+    {
+      std::cout << "  - QR decomposition reused from previous solve" << std::endl;
+    }
   }
   else
   {
@@ -414,6 +1850,38 @@ void Problem::dump_status()
   {
     std::cout << "  - Not using sparsity" << std::endl;
   }
+  if (hierarchical)
+  {
+    std::cout << "  - Hierarchical solve, levels times [ms]:";
+    for (double time : levels_solve_times)
+    {
+      std::cout << " " << time;
+    }
+    std::cout << std::endl;
+  }
+  if (direct_solved)
+  {
+    std::cout << "  - Direct solve (no inequalities)" << (factorization_reused ? ", factorization reused" : "")
+              << std::endl;
+  }
+  if (warm_start)
+  {
+    std::cout << "  - Warm start: " << (warm_started ? "success" : "fallback to cold solve") << " ("
+              << warm_start_iterations << " iterations)" << std::endl;
+  }
+  if (qp_solver == ADMM)
+  {
+    std::cout << "  - ADMM iterations: " << admm.iterations << " (primal residual: " << admm.primal_residual
+              << ", dual residual: " << admm.dual_residual << ")" << std::endl;
+  }
+  if (qp_solver == Riccati)
+  {
+    std::cout << "  - Riccati: " << (riccati_fallback ? "fallback to eiquadprog" : "success") << " ("
+              << riccati.iterations << " interior point iterations)" << std::endl;
+  }
+  std::cout << "  - Active set size: " << active_set_size << std::endl;
+  std::cout << "  - Solve time: " << solve_time << " ms" << std::endl;
+  std::cout << "  - Expression allocations: " << expression_allocations << std::endl;
 }
 
 };  // namespace placo::problem
\ No newline at end of file
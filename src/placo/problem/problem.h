@@ -7,6 +7,8 @@
 #include "placo/problem/variable.h"
 #include "placo/problem/constraint.h"
 #include "placo/problem/qp_error.h"
+#include "placo/problem/admm_solver.h"
+#include "placo/problem/riccati_solver.h"
 
 namespace placo::problem
 {
@@ -19,6 +21,34 @@ public:
   Problem();
   virtual ~Problem();
 
+  /**
+   * @brief Available QP solvers
+   */
+  enum QPSolver
+  {
+    /**
+     * @brief Dense active set solver (eiquadprog)
+     */
+    Eiquadprog = 0,
+
+    /**
+     * @brief Sparse ADMM solver (see \ref ADMMSolver), better suited for large problems whose constraints are sparse.
+     * Note that the expressions of \ref Integrator are dense (lower triangular) in the inputs, so the objective of long
+     * integrator horizons stays dense with this solver: use \ref Riccati for such problems
+     */
+    ADMM = 1,
+
+    /**
+     * @brief Riccati-based solver (see \ref RiccatiSolver), for problems whose variables are all the inputs of
+     * \ref Integrator with constant initial states and the same horizon. Each constraint row is then rewritten as a
+     * function of the state and input of a single stage. The Riccati recursion is linear in the horizon (see
+     * \ref RiccatiSolver for the cost of equalities), but this rewriting scans the dense expression rows, so building
+     * the problem is still quadratic in the horizon. If the problem doesn't have this structure (or has soft
+     * inequalities), \ref Eiquadprog is used instead and \ref riccati_fallback is set.
+     */
+    Riccati = 2
+  };
+
   /**
    * @brief Adds a n-dimensional variable to a problem
    * @param size dimension of the variable
@@ -42,10 +72,31 @@ public:
   ProblemConstraint& add_constraint(const ProblemConstraint& constraint);
 
   /**
-   * @brief Clear all the constraints
+   * @brief Clear all the constraints, and resets the \ref expression_pool
    */
   void clear_constraints();
 
+  /**
+   * @brief Number of constraints in the problem
+   */
+  int constraints_count() const;
+
+  /**
+   * @brief Stacked Lagrange multipliers (see \ref ProblemConstraint::duals) of the constraints in [start, end), in
+   * the order they were added to the problem
+   * @param start first constraint index
+   * @param end index after the last constraint
+   */
+  Eigen::VectorXd constraints_duals(int start, int end) const;
+
+  /**
+   * @brief Sets the priority level (see \ref ProblemConstraint::level) of the constraints in [start, end)
+   * @param start first constraint index
+   * @param end index after the last constraint
+   * @param level priority level
+   */
+  void set_constraints_level(int start, int end, int level);
+
   /**
    * @brief Clear all the variables
    */
@@ -105,9 +156,27 @@ public:
    */
   Eigen::VectorXd slacks;
 
+  /**
+   * @brief If set to true, soft constraints are solved lexicographically according to their
+   * \ref ProblemConstraint::level (lower levels first), as a cascade of QPs. Each level is solved in the nullspace of
+   * the soft equalities of the levels above it (the nullspace basis being refined from one level to the next), and
+   * the soft inequalities of the levels above are kept at their optimal violation. Within a level, soft constraints
+   * are weighted as usual.
+   *
+   * This mode always uses the dense backend, ignoring \ref qp_solver, \ref warm_start and \ref reuse_structure.
+   * Duals of hard inequalities are the ones of the last level, and duals of hard equalities are not computed.
+   */
+  bool hierarchical = false;
+
+  /**
+   * @brief Wall time of each level of the last hierarchical solve [ms], see \ref hierarchical
+   */
+  std::vector<double> levels_solve_times;
+
   /**
    * @brief If set to true, some sparsity optimizations will be performed when building the problem Hessian.
-   * This optimization is generally not useful for small problems.
+   * The columns sparsity of soft constraints is either taken from \ref ProblemConstraint::sparsity (when declared,
+   * and carried through the projection when equalities are rewritten) or detected from the expression. This optimization is generally not useful for small problems.
    */
   bool use_sparsity = true;
 
@@ -120,6 +189,138 @@ public:
    */
   bool rewrite_equalities = true;
 
+  /**
+   * @brief QP solver used by \ref solve.
+   *
+   * With \ref ADMM, the matrices are built in sparse form, equalities are not rewritten (\ref rewrite_equalities and
+   * \ref use_sparsity are ignored) and the solution is approximate up to the solver tolerances.
+   */
+  QPSolver qp_solver = Eiquadprog;
+
+  /**
+   * @brief Sparse solver used when \ref qp_solver is \ref ADMM, its parameters can be tuned here
+   */
+  ADMMSolver admm;
+
+  /**
+   * @brief Stage-wise solver used when \ref qp_solver is \ref Riccati
+   */
+  RiccatiSolver riccati;
+
+  /**
+   * @brief true if \ref Riccati was requested but the last solve had to fall back to \ref Eiquadprog
+   */
+  bool riccati_fallback = false;
+
+  /**
+   * @brief If set to true, the problem is assumed to keep the same structure (same sequence of constraint shapes)
+   * from one solve to the next one, which is typically the case in a control loop:
+   *
+   * - \ref clear_constraints keeps the constraint objects in memory, and \ref add_constraint will overwrite them
+   *   instead of allocating new ones,
+   * - if the structure didn't change since the previous solve, the QP matrices are not re-allocated and only their
+   *   numerical contents are overwritten.
+   *
+   * Note that with this mode enabled, constraints references are recycled after \ref clear_constraints.
+   */
+  bool reuse_structure = false;
+
+  /**
+   * @brief true if the last solve re-used the structure of the previous one (see \ref reuse_structure)
+   */
+  bool structure_reused = false;
+
+  /**
+   * @brief true if the last solve re-used the QR decomposition of the equality constraints computed by a previous
+   * solve, which happens when their matrix didn't change (only their right-hand side). See \ref rewrite_equalities
+   */
+  bool qr_reused = false;
+
+  /**
+   * @brief If set to true, the active set found by the previous solve is used as an initial guess. The QP is first
+   * solved assuming this active set, which is then refined for at most \ref warm_start_max_iterations iterations. If
+   * this doesn't yield an optimal solution (or if the problem shape changed), a cold solve is performed.
+   *
+   * This is useful when solving a sequence of similar problems (e.g. in a control loop).
+   */
+  bool warm_start = false;
+
+  /**
+   * @brief Maximum number of active set updates tried by the warm start before falling back to a cold solve
+   */
+  int warm_start_max_iterations = 8;
+
+  /**
+   * @brief true if the last solve was obtained from the warm start (the QP solver was not called)
+   */
+  bool warm_started = false;
+
+  /**
+   * @brief Number of active set iterations performed by the warm start during the last solve
+   */
+  int warm_start_iterations = 0;
+
+  /**
+   * @brief If set to true, a QP without inequalities (only soft constraints, possibly with hard equalities that were
+   * not rewritten) is solved directly from its KKT conditions using a Cholesky factorization of P, instead of calling
+   * the QP solver. The factorizations are reused from one solve to the next one if P and the equalities matrix
+   * didn't change (only q and the equalities right-hand side).
+   */
+  bool direct_solve = true;
+
+  /**
+   * @brief true if the last solve was obtained by the direct solve (see \ref direct_solve)
+   */
+  bool direct_solved = false;
+
+  /**
+   * @brief true if the last direct solve re-used the factorizations of the previous one
+   */
+  bool factorization_reused = false;
+
+  /**
+   * @brief If set to true, the hessian \f$A^T A\f$ of each soft constraint is kept from one solve to the next one,
+   * and is only computed again if A changed. When only the targets (b) of the soft constraints change, only q is
+   * updated. If only one weight changed, the factorization of the direct solve (see \ref direct_solve) is updated
+   * with rank one updates instead of being computed again.
+   *
+   * This is useful in a control loop where most tasks don't change from one solve to the next one, but comes with
+   * the memory cost of storing, for each soft constraint, the blocks of its hessian given by its columns sparsity
+   * (the full hessian if the constraint is dense).
+   */
+  bool incremental_objective = false;
+
+  /**
+   * @brief Maximum number of successive factorization updates (see \ref incremental_objective) before the
+   * factorization is computed again from scratch, to bound the accumulation of numerical errors
+   */
+  int max_rank_updates = 16;
+
+  /**
+   * @brief Size of the active set at the optimum (including equality constraints)
+   */
+  int active_set_size = 0;
+
+  /**
+   * @brief Wall time of the last solve [ms]
+   */
+  double solve_time = 0.;
+
+  /**
+   * @brief Number of expression buffers allocated on the heap to build the last solved problem: buffers allocated by
+   * the thread calling \ref solve, from the creation of the problem or the last call to \ref clear_constraints, to the
+   * start of \ref solve. Buffers taken from \ref expression_pool and allocations made by the solve itself are not
+   * counted, see \ref ExpressionPool::heap_allocations
+   */
+  int expression_allocations = 0;
+
+  /**
+   * @brief Pool for the expressions built for this problem. It is used by the expressions created while an
+   * \ref ExpressionPool::Scope on it is alive, and is reset by \ref clear_constraints (the constraints of the last
+   * solve stay valid until then). The expressions allocated from it should not be kept across solves
+   */
+  ExpressionPool expression_pool;
+
   void dump_status();
 
 protected:
@@ -128,11 +329,41 @@ protected:
    */
   Eigen::ColPivHouseholderQR<Eigen::Matrix<double, -1, -1, 1, -1, -1>> QR;
 
+  /**
+   * @brief Equality constraints matrix for which \ref QR was computed
+   */
+  Eigen::MatrixXd QR_equalities;
+
+  /**
+   * @brief Explicit (dense) Q matrix of the QR decomposition, its last \ref free_variables columns are a basis of the
+   * equality constraints nullspace
+   */
+  Eigen::MatrixXd Q;
+
+  /**
+   * @brief Columns sparsity of each row of the equality constraints nullspace basis (see \ref Q), used to carry the
+   * declared sparsity of the constraints through the projection
+   */
+  std::vector<Sparsity> nullspace_sparsity;
+
   /**
    * @brief Internal vector of determined values (in the Q basis)
    */
   Eigen::MatrixXd y;
 
+  /**
+   * @brief Particular solution of the equality constraints (Q y)
+   */
+  Eigen::VectorXd x_determined;
+
+  /**
+   * @brief Constraints (other than hard equalities) expressed in the free variables, stacked. The rows of a given
+   * constraint start at its entry in \ref projected_offsets (-1 if it is not projected)
+   */
+  Eigen::MatrixXd projected_A;
+  Eigen::VectorXd projected_b;
+  std::vector<int> projected_offsets;
+
   /**
    * @brief Problem variables
    */
@@ -143,13 +374,195 @@ protected:
    */
   std::vector<ProblemConstraint*> constraints;
 
+  /**
+   * @brief All allocated constraints, \ref constraints is always a prefix of this vector. When \ref reuse_structure
+   * is enabled, the constraints are kept here to be recycled by \ref add_constraint
+   */
+  std::vector<ProblemConstraint*> constraints_memory;
+
+  /**
+   * @brief Value of \ref ExpressionPool::heap_allocations when the problem was created or its constraints were cleared
+   */
+  size_t allocations_start = ExpressionPool::heap_allocations;
+
+  /**
+   * @brief Structure of the last solved problem (variables count and shape of all constraints)
+   */
+  std::vector<int> structure;
+
+  /**
+   * @brief QP objective min 1/2 x^T P x + q^T x, kept across solves to avoid re-allocations
+   */
+  Eigen::MatrixXd P;
+  Eigen::VectorXd q;
+
+  /**
+   * @brief QP inequalities Gx + h >= 0, kept across solves to avoid re-allocations
+   */
+  Eigen::MatrixXd G;
+  Eigen::VectorXd h;
+
+  /**
+   * @brief A constraint and a row of its expression
+   */
+  struct RowMapping
+  {
+    ProblemConstraint* constraint = nullptr;
+    int row = 0;
+  };
+
+  /**
+   * @brief Constraint row associated with each inequality row of the QP (no constraint for the rows enforcing the
+   * slack variables positivity), and with each slack variable. Kept across solves to avoid re-allocations
+   */
+  std::vector<RowMapping> inequalities_mapping;
+  std::vector<RowMapping> slacks_mapping;
+
+  /**
+   * @brief Constraint row associated with each hard equality row of the QP
+   */
+  std::vector<RowMapping> equalities_mapping;
+
+  /**
+   * @brief Resets the activity of all the constraints before a solve (equality constraints are always active)
+   */
+  void reset_activity();
+
+  /**
+   * @brief Marks a constraint row as active
+   */
+  static void set_active(const RowMapping& mapping);
+
+  /**
+   * @brief Sets the dual value of a constraint row
+   */
+  static void set_dual(const RowMapping& mapping, double dual);
+
+  /**
+   * @brief Computes the duals of soft constraints from their residuals, using \ref x and \ref slacks
+   */
+  void compute_soft_duals();
+
+  /**
+   * @brief Inequalities (rows of G) that were active after the last solve, used for warm start
+   */
+  std::vector<int> previous_active_set;
+
+  /**
+   * @brief Shape of the QP (number of QP variables, equalities and inequalities) for which \ref previous_active_set
+   * was computed
+   */
+  Eigen::Vector3i previous_shape = Eigen::Vector3i::Constant(-1);
+
+  /**
+   * @brief Tries to solve the QP using \ref previous_active_set as an initial guess for the active set
+   *
+   * Problem is min 1/2 x^T P x + q^T x, subject to Ax + b = 0 and Gx + h >= 0
+   *
+   * @return true if an optimal solution was found, in that case, x, duals (multipliers of the active constraints),
+   * active_set and active_set_size are updated following eiquadprog's conventions
+   */
+  bool solve_warm_start(const Eigen::MatrixXd& P, const Eigen::VectorXd& q, const Eigen::MatrixXd& A,
+                        const Eigen::VectorXd& b, const Eigen::MatrixXd& G, const Eigen::VectorXd& h,
+                        Eigen::VectorXd& x, Eigen::VectorXd& duals, Eigen::VectorXi& active_set,
+                        size_t& active_set_size);
+
+  /**
+   * @brief Soft constraint expression matrix A of the last solve, with its weight and the (unweighted) blocks of its
+   * hessian A^T A for the pairs of non-zero columns intervals of its sparsity, see \ref incremental_objective
+   */
+  struct SoftContribution
+  {
+    Eigen::MatrixXd A;
+    Sparsity sparsity;
+    std::vector<Eigen::MatrixXd> blocks;
+    double weight = 0.;
+  };
+
+  /**
+   * @brief Soft constraints contributions, indexed like \ref constraints
+   */
+  std::vector<SoftContribution> soft_contributions;
+
+  /**
+   * @brief Regularization used to build the last objective
+   */
+  double objective_regularization = 0.;
+
+  /**
+   * @brief Constraint whose weight (only) changed since the last objective (-1 if there is none, or if the objective
+   * changed otherwise), and the weight difference
+   */
+  int rank_update_constraint = -1;
+  double rank_update_weight = 0.;
+
+  /**
+   * @brief Number of successive updates applied to the direct solve factorization since it was last computed
+   */
+  int rank_updates = 0;
+
+  /**
+   * @brief Factorizations used by the direct solve, with the matrices they were computed for
+   */
+  Eigen::LLT<Eigen::MatrixXd> direct_llt;
+  Eigen::MatrixXd direct_P;
+  Eigen::ColPivHouseholderQR<Eigen::MatrixXd> direct_schur;
+  Eigen::MatrixXd direct_A;
+  Eigen::MatrixXd direct_P_inv_At;
+
+  /**
+   * @brief Solves a QP without inequalities, see \ref direct_solve
+   *
+   * Problem is min 1/2 x^T P x + q^T x, subject to Ax + b = 0
+   *
+   * @return true if the problem could be solved, in that case, x, duals, active_set and active_set_size are updated
+   * following eiquadprog's conventions
+   */
+  bool solve_direct(const Eigen::MatrixXd& P, const Eigen::VectorXd& q, const Eigen::MatrixXd& A,
+                    const Eigen::VectorXd& b, Eigen::VectorXd& x, Eigen::VectorXd& duals, Eigen::VectorXi& active_set,
+                    size_t& active_set_size);
+
+  /**
+   * @brief Solves the problem as a cascade of QPs, see \ref hierarchical
+   */
+  void solve_hierarchical();
+
+  /**
+   * @brief Builds the problem in sparse form and solves it with \ref admm
+   */
+  void solve_admm();
+
+  /**
+   * @brief Tries to rewrite the problem in stage-wise form and to solve it with \ref riccati
+   * @return false if the problem doesn't have the required structure
+   */
+  bool solve_riccati();
+
+  /**
+   * @brief Builds the hard equality constraints Ax + b = 0 (and \ref equalities_mapping), \ref n_equalities should be
+   * up to date
+   */
+  void build_equalities(Eigen::MatrixXd& A, Eigen::VectorXd& b);
+
+  /**
+   * @brief Computes (or re-uses) the QR decomposition of the equality constraints, updating \ref Q, \ref y,
+   * \ref x_determined, \ref determined_variables and \ref free_variables
+   */
+  void compute_equalities_nullspace(const Eigen::MatrixXd& A, const Eigen::VectorXd& b);
+
+  /**
+   * @brief Expresses all the constraints (except hard equalities) in the free variables with a single product by the
+   * nullspace basis, filling \ref projected_A, \ref projected_b and \ref projected_offsets
+   */
+  void project_constraints();
+
   /**
    * @brief Used internally to access a constraint expression, optionally applying the change of basis imposed by
    * the QR decomposition, see \ref rewrite_equalities.
-   * @param constraint constraint
+   * @param index constraint index (in \ref constraints)
    * @param A output matrix A
    * @param b output vector b
    */
-  void get_constraint_expressions(ProblemConstraint* constraint, Eigen::MatrixXd& A, Eigen::MatrixXd& b);
+  void get_constraint_expressions(int index, Eigen::MatrixXd& A, Eigen::MatrixXd& b);
 };
 }  // namespace placo::problem
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include "placo/problem/riccati_solver.h"
+#include "placo/problem/qp_error.h"
+
+namespace placo::problem
+{
+void RiccatiSolver::setup(const Eigen::MatrixXd& A_, const Eigen::MatrixXd& B_, const Eigen::VectorXd& s0_, int N_)
+{
+  A = A_;
+  B = B_;
+  s0 = s0_;
+  N = N_;
+
+  int nz = A.rows() + B.cols();
+  H.assign(N, Eigen::MatrixXd::Zero(nz, nz));
+  h.assign(N, Eigen::VectorXd::Zero(nz));
+  equalities.clear();
+  inequalities.clear();
+}
+
+void RiccatiSolver::solve_lq(const std::vector<Eigen::MatrixXd>& H_, const std::vector<Eigen::VectorXd>& h_)
+{
+  int nx = A.rows();
+  int nu = B.cols();
+  int ne = equalities.size();
+  int cols = 1 + ne;
+
+  // Linear terms, the first column is the cost and the others are the (unknown) equality multipliers
+  std::vector<Eigen::MatrixXd> L(N, Eigen::MatrixXd::Zero(nx + nu, cols));
+  for (int k = 0; k < N; k++)
+  {
+    L[k].col(0) = h_[k];
+  }
+  for (int j = 0; j < ne; j++)
+  {
+    L[equalities[j].stage].col(1 + j) += equalities[j].r;
+  }
+
+  // Backward pass, the value function is 1/2 s^T P s + s^T p
+  K.resize(N);
+  k_ff.resize(N);
+  Eigen::MatrixXd P = Eigen::MatrixXd::Zero(nx, nx);
+  Eigen::MatrixXd p = Eigen::MatrixXd::Zero(nx, cols);
+
+  for (int k = N - 1; k >= 0; k--)
+  {
+    Eigen::MatrixXd PA = P * A;
+    Eigen::MatrixXd PB = P * B;
+
+    Eigen::MatrixXd Q_xx = H_[k].topLeftCorner(nx, nx) + A.transpose() * PA;
+    Eigen::MatrixXd Q_ux = H_[k].bottomLeftCorner(nu, nx) + B.transpose() * PA;
+    Eigen::MatrixXd Q_uu = H_[k].bottomRightCorner(nu, nu) + B.transpose() * PB;
+    Eigen::MatrixXd Q_x = L[k].topRows(nx) + A.transpose() * p;
+    Eigen::MatrixXd Q_u = L[k].bottomRows(nu) + B.transpose() * p;
+
+    Eigen::LLT<Eigen::MatrixXd> llt(Q_uu);
+    if (llt.info() != Eigen::Success)
+    {
+      throw QPError("RiccatiSolver: the problem is not strictly convex in the inputs");
+    }
+
+    K[k] = -llt.solve(Q_ux);
+    k_ff[k] = -llt.solve(Q_u);
+
+    P = Q_xx + Q_ux.transpose() * K[k];
+    P = 0.5 * (P + P.transpose()).eval();
+    p = Q_x + Q_ux.transpose() * k_ff[k];
+  }
+
+  // The trajectory is affine in the equality multipliers, they are obtained by evaluating the equalities on a
+  // rollout
+  Eigen::VectorXd w(cols);
+  w.setZero();
+  w(0) = 1.;
+
+  if (ne > 0)
+  {
+    std::vector<std::vector<int>> stage_equalities(N);
+    for (int j = 0; j < ne; j++)
+    {
+      stage_equalities[equalities[j].stage].push_back(j);
+    }
+
+    Eigen::MatrixXd M(ne, cols);
+    Eigen::VectorXd e(ne);
+    Eigen::MatrixXd S = Eigen::MatrixXd::Zero(nx, cols);
+    Eigen::MatrixXd Z(nx + nu, cols);
+    S.col(0) = s0;
+
+    for (int k = 0; k < N; k++)
+    {
+      Z.topRows(nx) = S;
+      Z.bottomRows(nu) = K[k] * S + k_ff[k];
+
+      for (int j : stage_equalities[k])
+      {
+        M.row(j) = equalities[j].r.transpose() * Z;
+        e(j) = equalities[j].e;
+      }
+
+      S = A * S + B * Z.bottomRows(nu);
+    }
+
+    w.tail(ne) = M.rightCols(ne).colPivHouseholderQr().solve(-(M.col(0) + e));
+  }
+
+  // The multipliers enter the linear term of the cost, hence the sign
+  equalities_multipliers = -w.tail(ne);
+
+  // Final rollout
+  states.resize(nx, N + 1);
+  inputs.resize(nu, N);
+  Eigen::VectorXd s = s0;
+
+  for (int k = 0; k < N; k++)
+  {
+    states.col(k) = s;
+    inputs.col(k) = K[k] * s + k_ff[k] * w;
+    s = A * s + B * inputs.col(k);
+  }
+  states.col(N) = s;
+}
+
+Eigen::VectorXd RiccatiSolver::evaluate_inequalities()
+{
+  int nx = A.rows();
+  Eigen::VectorXd values(inequalities.size());
+
+  for (size_t i = 0; i < inequalities.size(); i++)
+  {
+    const Row& row = inequalities[i];
+    values(i) = row.r.head(nx).dot(states.col(row.stage)) + row.r.tail(B.cols()).dot(inputs.col(row.stage)) + row.e;
+  }
+
+  return values;
+}
+
+// Largest step in [0, 1] keeping v + alpha dv >= 0
+static double max_step(const Eigen::VectorXd& v, const Eigen::VectorXd& dv)
+{
+  double alpha = 1.;
+  for (int i = 0; i < v.rows(); i++)
+  {
+    if (dv(i) < 0)
+    {
+      alpha = std::min(alpha, -v(i) / dv(i));
+    }
+  }
+
+  return alpha;
+}
+
+void RiccatiSolver::solve()
+{
+  iterations = 0;
+  solve_lq(H, h);
+
+  int m = inequalities.size();
+  if (m == 0)
+  {
+    inequalities_values.resize(0);
+    inequalities_multipliers.resize(0);
+    return;
+  }
+
+  // Interior point variables: slacks t = Gz + g and multipliers mu, both kept positive
+  Eigen::VectorXd values = evaluate_inequalities();
+  Eigen::VectorXd t = values.cwiseMax(1.);
+  Eigen::VectorXd mu = Eigen::VectorXd::Ones(m);
+  Eigen::MatrixXd current_states = states;
+  Eigen::MatrixXd current_inputs = inputs;
+  Eigen::VectorXd current_multipliers = equalities_multipliers;
+
+  // The dual residual (initially G^T mu) decreases by a factor (1 - alpha) at each step
+  double dual_residual = 0.;
+  for (int i = 0; i < m; i++)
+  {
+    dual_residual = std::max(dual_residual, inequalities[i].r.lpNorm<Eigen::Infinity>());
+  }
+
+  std::vector<Eigen::MatrixXd> H_barrier(N);
+  std::vector<Eigen::VectorXd> h_barrier(N);
+
+  // Builds the linear terms of the Newton step for a given complementarity residual
+  auto build_linear_terms = [&](const Eigen::VectorXd& r_c, const Eigen::VectorXd& r_p) {
+    for (int k = 0; k < N; k++)
+    {
+      h_barrier[k] = h[k];
+    }
+    for (int i = 0; i < m; i++)
+    {
+      double Gz = values(i) - inequalities[i].e;
+      double coefficient = mu(i) + (mu(i) / t(i)) * Gz + (r_c(i) - mu(i) * r_p(i)) / t(i);
+      h_barrier[inequalities[i].stage] -= coefficient * inequalities[i].r;
+    }
+  };
+
+  for (iterations = 1; iterations <= max_iterations; iterations++)
+  {
+    Eigen::VectorXd r_p = values - t;
+    double complementarity = t.dot(mu) / m;
+
+    if (complementarity < tolerance && r_p.lpNorm<Eigen::Infinity>() < tolerance && dual_residual < tolerance)
+    {
+      break;
+    }
+
+    // Newton steps are linear-quadratic problems with the hessian augmented by G^T diag(mu / t) G
+    for (int k = 0; k < N; k++)
+    {
+      H_barrier[k] = H[k];
+    }
+    for (int i = 0; i < m; i++)
+    {
+      H_barrier[inequalities[i].stage].noalias() +=
+          (mu(i) / t(i)) * inequalities[i].r * inequalities[i].r.transpose();
+    }
+
+    Eigen::VectorXd dt, dmu;
+    auto newton_step = [&](const Eigen::VectorXd& r_c) {
+      build_linear_terms(r_c, r_p);
+      solve_lq(H_barrier, h_barrier);
+      dt = evaluate_inequalities() - values + r_p;
+      dmu = (r_c - mu.cwiseProduct(dt)).cwiseQuotient(t);
+    };
+
+    // Predictor (affine scaling) step
+    newton_step(-t.cwiseProduct(mu));
+    double alpha_affine = std::min(max_step(t, dt), max_step(mu, dmu));
+    double complementarity_affine = (t + alpha_affine * dt).dot(mu + alpha_affine * dmu) / m;
+    double sigma = std::pow(complementarity_affine / complementarity, 3);
+
+    // Corrector step
+    Eigen::VectorXd r_c = Eigen::VectorXd::Constant(m, sigma * complementarity) - t.cwiseProduct(mu) -
+                          dt.cwiseProduct(dmu);
+    newton_step(r_c);
+    double alpha = std::min(1., 0.99 * std::min(max_step(t, dt), max_step(mu, dmu)));
+
+    current_states += alpha * (states - current_states);
+    current_inputs += alpha * (inputs - current_inputs);
+    current_multipliers += alpha * (equalities_multipliers - current_multipliers);
+    t += alpha * dt;
+    mu += alpha * dmu;
+    dual_residual *= (1. - alpha);
+
+    states = current_states;
+    inputs = current_inputs;
+    values = evaluate_inequalities();
+  }
+
+  states = current_states;
+  inputs = current_inputs;
+  inequalities_values = values;
+  equalities_multipliers = current_multipliers;
+  inequalities_multipliers = mu;
+
+  if (iterations > max_iterations)
+  {
+    iterations = max_iterations;
+    throw QPError("RiccatiSolver: Infeasible QP (interior point did not converge)");
+  }
+}
+}  // namespace placo::problem
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <Eigen/Dense>
+
+namespace placo::problem
+{
+/**
+ * @brief Solver for linear-quadratic problems over a linear time-invariant system \f$s_{k+1} = A s_k + B u_k\f$
+ * (with fixed \f$s_0\f$), using a Riccati recursion.
+ *
+ * The cost is \f$\sum_k \frac{1}{2} z_k^T H_k z_k + h_k^T z_k\f$ with \f$z_k = [s_k, u_k]\f$ and constraints are
+ * expressed per stage as rows \f$r^T z_k + e\f$ (= 0 or >= 0).
+ *
+ * Inequalities are handled with a primal-dual interior point method (Mehrotra predictor-corrector) where each Newton
+ * step is itself a linear-quadratic problem solved by the Riccati recursion. Equalities are handled by noting that the
+ * solution is affine in their multipliers, which are solved for after a rollout. Each Newton step is then linear in the
+ * horizon, but the recursion carries one extra column per equality and the multipliers are obtained from a dense
+ * system, which is cubic in the number of equalities.
+ */
+class RiccatiSolver
+{
+public:
+  /**
+   * @brief A constraint row \f$r^T z_k + e\f$
+   */
+  struct Row
+  {
+    int stage;
+    Eigen::VectorXd r;
+    double e;
+  };
+
+  /**
+   * @brief Initializes the problem (dynamics, initial state and horizon), this clears the cost and the constraints
+   * @param A system matrix
+   * @param B input matrix
+   * @param s0 initial state
+   * @param N horizon (number of inputs)
+   */
+  void setup(const Eigen::MatrixXd& A, const Eigen::MatrixXd& B, const Eigen::VectorXd& s0, int N);
+
+  /**
+   * @brief Solves the problem, raises \ref QPError in case of failure
+   */
+  void solve();
+
+  /**
+   * @brief System dynamics
+   */
+  Eigen::MatrixXd A;
+  Eigen::MatrixXd B;
+
+  /**
+   * @brief Initial state
+   */
+  Eigen::VectorXd s0;
+
+  /**
+   * @brief Horizon
+   */
+  int N = 0;
+
+  /**
+   * @brief Stage costs (hessians and linear terms), for k in [0, N-1]
+   */
+  std::vector<Eigen::MatrixXd> H;
+  std::vector<Eigen::VectorXd> h;
+
+  /**
+   * @brief Equality constraints rows (r^T z_k + e = 0)
+   */
+  std::vector<Row> equalities;
+
+  /**
+   * @brief Inequality constraints rows (r^T z_k + e >= 0)
+   */
+  std::vector<Row> inequalities;
+
+  /**
+   * @brief States (one column per stage, from 0 to N) and inputs (one column per stage, from 0 to N-1) after the
+   * solve
+   */
+  Eigen::MatrixXd states;
+  Eigen::MatrixXd inputs;
+
+  /**
+   * @brief Inequalities values after the solve
+   */
+  Eigen::VectorXd inequalities_values;
+
+  /**
+   * @brief Lagrange multipliers of the equalities and inequalities after the solve, such that the gradient of the
+   * cost (with respect to the inputs) is the sum of the constraints gradients weighted by the multipliers
+   */
+  Eigen::VectorXd equalities_multipliers;
+  Eigen::VectorXd inequalities_multipliers;
+
+  /**
+   * @brief Maximum number of interior point iterations
+   */
+  int max_iterations = 50;
+
+  /**
+   * @brief Tolerance on the complementarity and residuals
+   */
+  double tolerance = 1e-9;
+
+  /**
+   * @brief Number of interior point iterations performed by the last solve
+   */
+  int iterations = 0;
+
+protected:
+  /**
+   * @brief Solves the equality constrained linear-quadratic problem with the given stage costs. The result is
+   * stored in \ref states and \ref inputs
+   */
+  void solve_lq(const std::vector<Eigen::MatrixXd>& H_, const std::vector<Eigen::VectorXd>& h_);
+
+  /**
+   * @brief Computes the inequality rows values G z + g for the current \ref states and \ref inputs
+   */
+  Eigen::VectorXd evaluate_inequalities();
+
+  /**
+   * @brief Feedback gains and affine terms (one column for the cost, then one per equality multiplier)
+   */
+  std::vector<Eigen::MatrixXd> K;
+  std::vector<Eigen::MatrixXd> k_ff;
+};
+}  // namespace placo::problem
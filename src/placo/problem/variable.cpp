@@ -14,10 +14,7 @@ Expression Variable::expr(int start, int rows)
   }
 
   Expression e;
-  e.A = Eigen::MatrixXd(rows, k_end);
-  e.A.setZero();
-  e.b = Eigen::VectorXd(rows);
-  e.b.setZero();
+  e.allocate(rows, k_end);
 
   for (int k = 0; k < rows; k++)
   {
@@ -47,6 +47,16 @@ public:
    */
   int version = 0;
 
+  /**
+   * @brief Discrete dynamics \f$s_{k+1} = A s_k + B u_k\f$ and initial state \f$s_0\f$ of the system integrating
+   * this variable (the variable being the sequence of inputs \f$u_k\f$). They are set by \ref Integrator when the
+   * initial state is constant, and empty otherwise. This allows \ref Problem to solve in stage-wise form (see
+   * \ref Problem::Riccati).
+   */
+  Eigen::MatrixXd integrator_A;
+  Eigen::VectorXd integrator_B;
+  Eigen::VectorXd integrator_X0;
+
   /**
    * @brief Variable's problem
    */
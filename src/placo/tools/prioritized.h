@@ -71,5 +71,23 @@ public:
    * @brief The oject weight, used for soft tasks only
    */
   double weight;
+
+  /**
+   * @brief Priority level (lower levels are more important), used for soft objects when the problem is solved
+   * hierarchically, see \ref placo::problem::Problem::hierarchical
+   */
+  int level = 0;
+
+  /**
+   * @brief Lagrange multipliers of the problem constraints produced by this object during the last solve (stacked),
+   * see \ref placo::problem::ProblemConstraint::duals
+   */
+  Eigen::VectorXd duals;
+
+  /**
+   * @brief Range [start, end) of the problem constraints produced by this object during the last solve
+   */
+  int problem_constraints_start = 0;
+  int problem_constraints_end = 0;
 };
 }  // namespace placo::tools
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include "placo/tools/thread_pool.h"
+
+namespace placo::tools
+{
+// Pool and index of the worker running in the current thread, if any
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local int current_thread = 0;
+
+ThreadPool::ThreadPool(int threads)
+{
+  if (threads <= 0)
+  {
+    threads = std::max<int>(1, std::thread::hardware_concurrency());
+  }
+
+  for (int thread = 0; thread < threads; thread++)
+  {
+    queues.push_back(std::make_unique<Queue>());
+  }
+
+  for (int thread = 0; thread < threads; thread++)
+  {
+    workers.push_back(std::thread(&ThreadPool::worker_loop, this, thread));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  batch_started.notify_all();
+
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+}
+
+int ThreadPool::size() const
+{
+  return workers.size();
+}
+
+ThreadPool& ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::run(int count, const std::function<void(int, int)>& job_)
+{
+  if (count <= 0)
+  {
+    return;
+  }
+
+  // Nested batches are run in the current worker, since the other workers may be busy with the outer batch
+  if (current_pool == this)
+  {
+    std::exception_ptr error = nullptr;
+    for (int index = 0; index < count; index++)
+    {
+      try
+      {
+        job_(index, current_thread);
+      }
+      catch (...)
+      {
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+    }
+
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &job_;
+    errors.assign(count, nullptr);
+    remaining = count;
+
+    // Contiguous chunks of jobs are given to each worker
+    int threads = size();
+    for (int thread = 0; thread < threads; thread++)
+    {
+      std::lock_guard<std::mutex> queue_lock(queues[thread]->mutex);
+      for (int index = (count * thread) / threads; index < (count * (thread + 1)) / threads; index++)
+      {
+        queues[thread]->jobs.push_back(index);
+      }
+    }
+
+    generation += 1;
+  }
+  batch_started.notify_all();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  batch_done.wait(lock, [this] { return remaining == 0; });
+  job = nullptr;
+
+  for (auto& error : errors)
+  {
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+bool ThreadPool::pop_job(int thread, int& index)
+{
+  int threads = size();
+
+  for (int k = 0; k < threads; k++)
+  {
+    Queue& queue = *queues[(thread + k) % threads];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (!queue.jobs.empty())
+    {
+      // Own jobs are taken from the front, stolen ones from the back
+      if (k == 0)
+      {
+        index = queue.jobs.front();
+        queue.jobs.pop_front();
+      }
+      else
+      {
+        index = queue.jobs.back();
+        queue.jobs.pop_back();
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::worker_loop(int thread)
+{
+  int seen_generation = 0;
+  current_pool = this;
+  current_thread = thread;
+
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      batch_started.wait(lock, [&] { return stop || generation != seen_generation; });
+      if (stop)
+      {
+        return;
+      }
+      seen_generation = generation;
+    }
+
+    int index;
+    while (pop_job(thread, index))
+    {
+      try
+      {
+        (*job)(index, thread);
+      }
+      catch (...)
+      {
+        errors[index] = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      remaining -= 1;
+      if (remaining == 0)
+      {
+        batch_done.notify_all();
+      }
+    }
+  }
+}
+}  // namespace placo::tools
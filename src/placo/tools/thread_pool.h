@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace placo::tools
+{
+/**
+ * @brief A pool of persistent worker threads, used to run batches of independent jobs.
+ *
+ * The jobs of a batch are split in contiguous chunks, one per worker queue. A worker that runs out of jobs steals
+ * jobs from the back of the other queues. Since the workers are kept alive from one batch to the next, their
+ * thread-local buffers are re-used.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * @brief Creates the pool
+   * @param threads number of worker threads (0 to use the number of hardware threads)
+   */
+  ThreadPool(int threads = 0);
+  virtual ~ThreadPool();
+
+  /**
+   * @brief Runs job(index, thread) for all index in [0, count), and waits for all the jobs to be completed.
+   *
+   * thread is the index of the worker running the job (in [0, size()[), it can be used to access per-thread scratch
+   * data. If some jobs raise exceptions, all the jobs are still run and the exception of the job with the lowest
+   * index is rethrown.
+   *
+   * If it is called from a job running in this pool, the jobs are run sequentially in the calling worker.
+   *
+   * @param count number of jobs
+   * @param job job function
+   */
+  void run(int count, const std::function<void(int, int)>& job);
+
+  /**
+   * @brief Number of worker threads
+   */
+  int size() const;
+
+  /**
+   * @brief A pool shared by the batch APIs, using the number of hardware threads
+   */
+  static ThreadPool& shared();
+
+protected:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<int> jobs;
+  };
+
+  /**
+   * @brief Workers main loop
+   */
+  void worker_loop(int thread);
+
+  /**
+   * @brief Gets a job to run for a given worker, from its own queue or stolen from another one
+   * @return false if there are no more jobs to run
+   */
+  bool pop_job(int thread, int& index);
+
+  std::vector<std::thread> workers;
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  /**
+   * @brief Only one batch can run at a time
+   */
+  std::mutex run_mutex;
+
+  /**
+   * @brief Protects the batch state below
+   */
+  std::mutex mutex;
+  std::condition_variable batch_started;
+  std::condition_variable batch_done;
+
+  const std::function<void(int, int)>* job = nullptr;
+  std::vector<std::exception_ptr> errors;
+  int generation = 0;
+  int remaining = 0;
+  bool stop = false;
+};
+}  // namespace placo::tools